@@ -1,14 +1,25 @@
 #include "contiki.h"
 #include "dev/button-sensor.h"
 #include "dev/sht11/sht11-sensor.h"
+#include "dev/serial-line.h"
 #include "sys/etimer.h"
 #include "net/rime/rime.h"
 #include "stdio.h"
+#include "string.h"
+#include "its-msg.h"
+#include "sht11-conv.h"
+#include "energy-acct.h"
+#include "latency.h"
+#include "its-log.h"
+#include "dup-filter.h"
+#include "link-stats.h"
+#include "tx-queue.h"
+#include "deadband.h"
+#include "sample-batch.h"
 
 //#define COOJA
-#define DEBUG
 
-#ifdef COOJA
+#if defined(COOJA) || defined(CONTIKI_TARGET_NATIVE)	// Cooja e simulatore native (sim/run-native.sh)
 	#define G1_ADDR 		1 	
 	#define G2_ADDR 		2	
 	#define TL1_ADDR 		3   
@@ -23,13 +34,8 @@
 #define bool 				char 
 #define true 				1
 #define false 				0
-#define MAX_RETRANSMISSIONS 5
-#define HUMIDITY_SENS		2 // Parametro divisore di CLOCK_SECOND; il risultato sarà: CLOCK_SECOND / HUMIDITY_SENS
-
-typedef struct {
-	char type;
-	int value;
-} measurement_t;
+#define ENERGY_PERIOD		10		// Secondi fra due aggiornamenti della contabilità energetica
+#define ENERGY_REPORT_EVERY	6		// Aggiornamenti per report a G1
 
 typedef enum { NONE, NORMAL, EMERGENCY } vehicle_t;
 typedef enum { DEFAULT, NOTIFY_VEHICLE, RESTORE_VEHICLE } state_t;
@@ -39,69 +45,114 @@ AUTOSTART_PROCESSES(&g2);
 
 static const linkaddr_t tl2_addr = {{TL2_ADDR, 0}};
 static size_t state = NONE;								// Variabile che tiene lo stato della macchina (Mote)
+static clock_time_t press;						// Prima pressione del veicolo in classificazione
+static latency_pending_t pending;				// Veicoli notificati in attesa del verde
+
+// Latenze dei veicoli di questo sensore (comando seriale LAT)
+static latency_hist_t lat_notify = {"pressione-notifica"};
+static latency_hist_t lat_tl = {"decisione-notifica TL"};
+static latency_hist_t lat_total = {"pressione-verde"};
+
+// Verde dal proprio TL: serve tutti i veicoli notificati finora
+static void green_received(void){
+
+	const its_msg_vehicle_t *green = its_msg_get(ITS_MSG_GREEN, sizeof(*green));
+	uint8_t i;
+
+	if(green == NULL)
+		return;
+	latency_add(&lat_tl, green->age);
+	for(i = 0; i < pending.count; i++)
+		latency_add(&lat_total, clock_time() - pending.press[i]);
+	latency_pending_clear(&pending);
+
+}
+
+static void print_latency(void){
+	latency_print(&lat_notify);
+	latency_print(&lat_tl);
+	latency_print(&lat_total);
+	printf("DUP: scartati %u\n", dup_filter_dropped());
+}
 
 static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8_t seqno){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message received from %d.%d\n", from->u8[0], from->u8[1]);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_RECV, from->u8[0], seqno, its_msg_type());
+	link_stats_rx(from);
+	// Ritrasmissione di un pacchetto già elaborato (ack perso)
+	if(dup_filter_check(from, seqno)){
+		ITS_LOG_DBG(RADIO, RUNICAST_DUP, from->u8[0], seqno, dup_filter_dropped());
+		return;
+	}
 }
 
 static void sent_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message sent to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_SENT, to->u8[0], retransmissions);
+	tx_queue_done(to, retransmissions, 1);
 }
 
-static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){}
+static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
+	ITS_LOG_ERR(RADIO, RUNICAST_TIMEOUT, to->u8[0]);
+	tx_queue_done(to, retransmissions, 0);
+}
 
 static const struct runicast_callbacks runicast_calls = {recv_runicast, sent_runicast, timedout_runicast};
 static struct runicast_conn runicast;
 
 static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){
 
-	#ifdef DEBUG
-		printf("DEBUG: broadcast message received from %d.%d\n", from->u8[0], from->u8[1]);
-	#endif
+	ITS_LOG_DBG(RADIO, BROADCAST_RECV, from->u8[0], its_msg_type());
+	link_stats_rx(from);
 
-	// Ripristino lo stato del sensore quando questo riceve notifica da TL2
-	if(linkaddr_cmp(from, &tl2_addr) && state == NOTIFY_VEHICLE){
-		state = RESTORE_VEHICLE;						
-		process_post(&g2, PROCESS_EVENT_MSG, NULL);
+	// Il verde di TL2 scarica la coda del semaforo: il sensore è già pronto per il prossimo veicolo
+	if(linkaddr_cmp(from, &tl2_addr) && its_msg_type() == ITS_MSG_GREEN){
+		ITS_LOG_INFO(TRAFFIC, GREEN, 2);
+		green_received();
 	}
 
 }
 
 static void broadcast_sent(struct broadcast_conn *c, int status, int num_tx){
-	#ifdef DEBUG
-		printf("DEBUG: message sent in broadcast\n");
-	#endif
+	ITS_LOG_DBG(RADIO, BROADCAST_SENT, status, num_tx);
 }
 
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv, broadcast_sent}; 
 static struct broadcast_conn broadcast;
 
+static const struct broadcast_callbacks energy_call = {NULL};
+static struct broadcast_conn energy_broadcast;	// Report di energia verso G1 (ITS_MSG_ENERGY_CHANNEL)
+
 PROCESS_THREAD(g2, ev, data){
 
-	// Timer per la doppia pressione del tasto, per inviare notifica a TL dopo una già inviata e per fare sensing
-	static struct etimer double_press_timer, waiting_notify_timer, sensing_timer, humidity_timer;	
+	// Timer per la doppia pressione del tasto, per fare sensing e per la contabilità energetica
+	static struct etimer double_press_timer, sensing_timer, energy_timer;
 
 	PROCESS_EXITHANDLER(runicast_close(&runicast));
 	PROCESS_EXITHANDLER(broadcast_close(&broadcast));
+	PROCESS_EXITHANDLER(broadcast_close(&energy_broadcast));
 
 	PROCESS_BEGIN();
 
-	static bool tl_notified = false;		// Flag attivo quando il mote notifica l'arrivo del veicolo al suo TL*
-	static bool etimer_active = false;		// Flag attivo quando si attiva waiting_notify_timer
-	static bool transmit = false;			
-	static char message[2];					// Buffer per inviare msg
-	static int temperature = 0, humidity = 0;
-	static measurement_t sensing;			// Buffer per collezionare valori di sensing ed inviarli a G1
+	static its_msg_notify_t message;		// Buffer per inviare msg
+	static its_msg_upgrade_t upgrade;		// Upgrade a emergenza del veicolo notificato
+	static its_msg_count_t count = {0, 0, 0};	// Veicoli contati dall'avvio, per classe
+	static sample_t sensing;				// Ultima misura di temperatura e umidità
+	static sample_batch_t batch;			// Misure in attesa di invio a G1
+	static its_msg_batch_t upload;			// Frame del batch
+	static deadband_t deadband;				// Ultima misura inviata a G1
 	static vehicle_t vehicle = NONE;		// Variabile che tiene lo stato del veicolo sulla propria strada (G1, TL1) e (G2, TL2)
+	static its_msg_energy_t report;			// Report dei consumi per stato verso G1
+	static uint8_t updates = 0;				// Aggiornamenti della contabilità dall'ultimo report
+	static uint8_t previous;				// Stato energetico interrotto dal sensing
 	static linkaddr_t recv;
 
 	etimer_set(&sensing_timer, CLOCK_SECOND * 5);
 	runicast_open(&runicast, 144, &runicast_calls);
+	tx_queue_open(&runicast);
 	broadcast_open(&broadcast, 150, &broadcast_call);
+	broadcast_open(&energy_broadcast, ITS_MSG_ENERGY_CHANNEL, &energy_call);
+	energy_acct_init();
+	its_log_init();
+	etimer_set(&energy_timer, CLOCK_SECOND * ENERGY_PERIOD);
 	SENSORS_ACTIVATE(button_sensor);
 	
 	recv.u8[0] = G1_ADDR;
@@ -116,94 +167,113 @@ PROCESS_THREAD(g2, ev, data){
 		//	- ricezione msg da TL
 		PROCESS_WAIT_EVENT();
 
-		if(transmit == true && etimer_expired(&humidity_timer) && !runicast_is_transmitting(&runicast)){
-			transmit = false;
-			packetbuf_copyfrom(&sensing, sizeof(sensing));
-			runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
+		// Contabilità energetica e report periodico a G1
+		if(ev == PROCESS_EVENT_TIMER && data == &energy_timer){
+
+			etimer_reset(&energy_timer);
+			energy_acct_update();
+			if(++updates == ENERGY_REPORT_EVERY){
+				updates = 0;
+				energy_acct_report(&report, ENERGY_PERIOD * ENERGY_REPORT_EVERY);
+				packetbuf_copyfrom(&report, sizeof(report));
+				broadcast_send(&energy_broadcast);
+			}
+			continue;
+
+		}
+
+		// Comandi da seriale
+		if(ev == serial_line_event_message){
+			if(!strcmp((char *) data, "LAT"))
+				print_latency();
+			else if(!strcmp((char *) data, "LINKS"))
+				link_stats_print();
+			continue;
 		}
 
 		// Sensing e broadcast
 		if(etimer_expired(&sensing_timer)){
 
+			// Temperatura e umidità viaggiano nello stesso batch
+			previous = energy_acct_enter(ENERGY_SENSING);
 			SENSORS_ACTIVATE(sht11_sensor);
-			sensing.type = 'T';
-			sensing.value = (sht11_sensor.value(SHT11_SENSOR_TEMP)/10 - 396)/10;
-			temperature = sensing.value;
+			sensing.temperature = sht11_conv_temperature(sht11_sensor.value(SHT11_SENSOR_TEMP));
+			sensing.humidity = sht11_conv_humidity(sht11_sensor.value(SHT11_SENSOR_HUMIDITY), sensing.temperature);
+			SENSORS_DEACTIVATE(sht11_sensor);
 
-			if(!runicast_is_transmitting(&runicast)) {
-				packetbuf_copyfrom(&sensing, sizeof(sensing));
-				runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
+			// La misura entra nel batch solo se è cambiata o per heartbeat; G1 tiene valida l'ultima ricevuta
+			if(deadband_changed(&deadband, sensing.temperature, sensing.humidity)){
+				sample_batch_add(&batch, sensing.temperature, sensing.humidity);
+				deadband_sent(&deadband, sensing.temperature, sensing.humidity);
 			}
-			
-			sensing.type = 'H';
-			humidity = sht11_sensor.value(SHT11_SENSOR_HUMIDITY);
-			// Fix umidità
-			sensing.value = -4 + 0.0405 * humidity + (-2.8 * 0.000001) * (humidity * humidity);
-			sensing.value = (temperature - 25) * (0.01 + 0.00008 * humidity) + sensing.value;
-			SENSORS_DEACTIVATE(sht11_sensor);
 
-			transmit = true;
-			etimer_set(&humidity_timer, CLOCK_SECOND / HUMIDITY_SENS);
+			// Buffer pieno o misura più vecchia in scadenza: un solo frame per tutte le misure accumulate.
+			// Con un batch ancora in coda le misure restano nel buffer e partono nel frame successivo
+			if(sample_batch_due(&batch) && tx_queue_pending(TX_QUEUE_TELEMETRY) == 0)
+				tx_queue_push(TX_QUEUE_TELEMETRY, &recv, &upload, sample_batch_encode(&batch, &upload));
+			energy_acct_enter(previous);
+
 			etimer_reset(&sensing_timer);
 			continue;
 
 		}
 
 		// Eventi legati al bottone
-		if(state == NONE && ev == sensors_event && data == &button_sensor){
+		if(state == DEFAULT && ev == sensors_event && data == &button_sensor){
 
-			printf("STATO: NONE\n");
-
-			if(vehicle == NONE){
-
-				vehicle = NORMAL;
-				state = NOTIFY_VEHICLE;
-				etimer_set(&double_press_timer, CLOCK_SECOND * 0.5);	
-				continue;
-		
-			}
+			ITS_LOG_INFO(TRAFFIC, STATE_NONE);
 
+			// Seconda pressione entro la finestra: il veicolo appena notificato è un'emergenza
 			if(vehicle == NORMAL && etimer_expired(&double_press_timer) == 0){
-
 				vehicle = EMERGENCY;
-				etimer_stop(&double_press_timer); // Fai scadere il timer..
-				continue;
-
+				count.normal--;
+				count.emergency++;
+				etimer_stop(&double_press_timer);
+			}else{	// Nuovo veicolo: notificato subito come normale, la finestra della doppia pressione resta aperta
+				press = clock_time();
+				vehicle = NORMAL;
+				count.normal++;
+				if(count.boot == 0)		// Avvio riconosciuto dai TL: tick della prima pressione, mai 0
+					count.boot = press % 255 + 1;
+				etimer_set(&double_press_timer, CLOCK_SECOND * 0.5);
 			}
+			state = NOTIFY_VEHICLE;
+			energy_acct_enter(ENERGY_NOTIFY);
 
 		}
 
-		// Timer scaduto per definire il veicolo: invio notifica al semaforo
-		if(state == NOTIFY_VEHICLE && tl_notified == false){
-
-			// Condizione necessaria nel caso il semaforo TL* abbia già ricevuto un veicolo da meno di 5 secondi.
-			if(etimer_active == false || (etimer_active == true && etimer_expired(&waiting_notify_timer))){
+		// Notifica al semaforo: il nuovo veicolo o l'upgrade a emergenza dell'ultimo notificato
+		if(state == NOTIFY_VEHICLE){
 
-				printf("STATO: NOTIFY_VEHICLE\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_NOTIFY_VEHICLE);
 
-				tl_notified = true;
-				SENSORS_DEACTIVATE(button_sensor);
-				sprintf(message, "%d", vehicle);
-				packetbuf_copyfrom(message, 2);
+			if(vehicle == EMERGENCY){
+				its_msg_init(&upgrade.hdr, ITS_MSG_UPGRADE);
+				upgrade.age = clock_time() - press;
+				upgrade.count = count;
+				packetbuf_copyfrom(&upgrade, sizeof(upgrade));
+				broadcast_send(&broadcast);
+			}else{
+				its_msg_init(&message.hdr, ITS_MSG_VEHICLE);
+				message.vehicle = vehicle;
+				message.age = clock_time() - press;
+				message.count = count;
+				latency_add(&lat_notify, message.age);
+				latency_pending_push(&pending, press, press);
+				packetbuf_copyfrom(&message, sizeof(message));
 				broadcast_send(&broadcast);
-
 			}
-
-			continue;
+			state = RESTORE_VEHICLE;		// Il semaforo accoda il veicolo: non serve attendere il verde
 
 		}
 
-		// Ricezione msg dal semaforo
-		if(state == RESTORE_VEHICLE){ // Arriva l'okay dal semaforo
+		// Notifica inviata, pronto per il prossimo veicolo
+		if(state == RESTORE_VEHICLE){
 
-			printf("STATO: RESTORE_VEHICLE\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_RESTORE_VEHICLE);
 
-			state = DEFAULT;
-			vehicle = NONE;
-			tl_notified = false;
-			etimer_active = true;
-			etimer_set(&waiting_notify_timer, CLOCK_SECOND * 5);
-			SENSORS_ACTIVATE(button_sensor);
+			state = DEFAULT;		// vehicle resta NORMAL: una seconda pressione nella finestra è un upgrade
+			energy_acct_enter(ENERGY_IDLE);
 
 		}
 
@@ -0,0 +1,37 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+// G2 trasmette poco (notifiche dei veicoli e misure a lotti, solo su variazione
+// o come heartbeat: common/deadband.h, common/sample-batch.h) e riceve solo il
+// verde: canale controllato 8 volte al secondo (il default della Sky), coda corta.
+// Sovrascrivibile da bench/run.sh (BENCH_CHECK_RATE_<ruolo>) per confrontare le frequenze
+#ifdef ITS_CONF_CHECK_RATE
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	ITS_CONF_CHECK_RATE
+#else
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	8
+#endif
+#define QUEUEBUF_CONF_NUM			4
+
+#if CONTIKI_TARGET_NATIVE
+	// Radio simulata su UDP loopback (sim/sim-radio.c): sempre accesa, senza duty cycling
+	#define NETSTACK_CONF_RADIO		sim_radio_driver
+	#define NETSTACK_CONF_RDC			nullrdc_driver
+#else
+	// Duty cycling della radio: la radio resta spenta tra due controlli del canale
+	#define NETSTACK_CONF_MAC			csma_driver
+	#define NETSTACK_CONF_RDC			contikimac_driver
+	#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION	1	// Runicast: trasmette solo attorno al risveglio noto del vicino
+	// Seriale a interrupt: il drain del log (common/its-log.c) non attende la UART byte per byte
+	#define UART1_CONF_TX_WITH_INTERRUPT	1
+#endif
+
+// Solo Rime e messaggi ITS di poche decine di byte: buffer ridotti per liberare RAM
+#define PACKETBUF_CONF_SIZE			64
+
+// Misure inviate a G1 solo su variazione o come heartbeat (common/deadband.h)
+#define DEADBAND_CONF_ON			1
+
+// Contabilità energetica per stato (common/energy-acct.c)
+#define ENERGEST_CONF_ON			1
+
+#endif /* PROJECT_CONF_H_ */
@@ -5,15 +5,30 @@
 #include "dev/button-sensor.h"
 #include "dev/sht11/sht11-sensor.h"
 #include "dev/leds.h"
+#include "dev/serial-line.h"
 #include "sys/etimer.h"
 #include "net/rime/rime.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
+#include "its-msg.h"
+#include "sht11-conv.h"
+#include "arbiter.h"
+#include "vehicle-queue.h"
+#include "phase-timing.h"
+#include "energy-acct.h"
+#include "deadband.h"
+#include "sample-batch.h"
+#include "sensing-policy.h"
+#include "latency.h"
+#include "its-log.h"
+#include "dup-filter.h"
+#include "link-stats.h"
+#include "tx-queue.h"
 
 //#define COOJA
-#define DEBUG
 
-#ifdef COOJA
+#if defined(COOJA) || defined(CONTIKI_TARGET_NATIVE)	// Cooja e simulatore native (sim/run-native.sh)
 	#define G1_ADDR 		1 
 	#define G2_ADDR 		2	
 	#define TL1_ADDR 		3  
@@ -28,276 +43,256 @@
 #define bool 				char 
 #define true 				1
 #define false 				0
-#define MAX_RETRANSMISSIONS	5
-#define HUMIDITY_SENS		2 // Parametro divisore di CLOCK_SECOND; il risultato sarà: CLOCK_SECOND / HUMIDITY_SENS
-
-typedef struct {
-	char type;
-	int value;
-} measurement_t;
+#define ENERGY_PERIOD		10		// Secondi fra due aggiornamenti della contabilità energetica
+#define ENERGY_REPORT_EVERY	6		// Aggiornamenti per report a G1
 
 // Vehicle states, VOID is default state
 typedef enum { NONE, NORMAL, EMERGENCY } vehicle_t;
 // TL state, BLINK is default state
 typedef enum { BLINK, MANAGE_TRAFFIC, SEND_NOTIFY_CAR, RED_TL, GREEN_TL, RESTORE_TL } state_t;
 
-PROCESS(tl,"TL SkyMote");
-AUTOSTART_PROCESSES(&tl);
+// Un processo per sottosistema: ognuno si sveglia solo per i propri timer ed eventi
+PROCESS(tl_traffic, "TL traffic");
+PROCESS(tl_sensing, "TL sensing");
+PROCESS(tl_energy, "TL energy");
+PROCESS(tl_serial, "TL serial");
+AUTOSTART_PROCESSES(&tl_traffic, &tl_sensing, &tl_energy, &tl_serial);
+
+static const struct broadcast_callbacks energy_call = {NULL};
+static struct broadcast_conn energy_broadcast;	// Report di energia verso G1 (ITS_MSG_ENERGY_CHANNEL)
 
 static const linkaddr_t g1_addr  = {{G1_ADDR, 0}};  	// Strutture contenenti l'indirizzo dei Mote
 static const linkaddr_t g2_addr = {{G2_ADDR, 0}};
 static const linkaddr_t tl1_addr = {{TL1_ADDR, 0}};
 static const linkaddr_t tl2_addr = {{TL2_ADDR, 0}};
 static state_t state = BLINK;					// Variabile che tiene lo stato della macchina (Mote)
-static vehicle_t my_vehicle = NONE;				// Variabile che tiene lo stato del veicolo sulla propria strada (G1, TL1) e (G2, TL2)
-static vehicle_t its_vehicle = NONE;			// Variabile che tiene lo stato del veicolo sull'altra strada (G1, TL2) o (G2, TL1)
+static vehicle_queue_t my_queue;				// Veicoli in attesa sulla propria strada (G1, TL1) e (G2, TL2)
+static vehicle_queue_t its_queue;				// Veicoli in attesa sull'altra strada (G1, TL2) o (G2, TL1)
+static vehicle_count_t my_count;				// Ultimo report cumulativo del G* della propria strada
+static vehicle_count_t its_count;				// Ultimo report cumulativo del G* dell'altra strada
+static phase_timing_t my_timing;				// Ritmo degli arrivi e statistiche di attesa sulla propria strada
+static phase_timing_t its_timing;				// Ritmo degli arrivi e statistiche di attesa sull'altra strada
+static movement_set_t my_movement;		// Movimento servito da questo semaforo (arbiter.h)
+static movement_set_t its_movement;		// Movimento servito dall'altro semaforo
+static latency_pending_t my_pending;	// Pressione e ricezione dei veicoli sulla propria strada
+static clock_time_t decision;			// Istante in cui MANAGE_TRAFFIC ha dato il verde alla propria strada
+static bool preempt = false;			// Emergenza senza altre emergenze in coda: la fase in corso va interrotta
+static clock_time_t emergency_press;	// Pressione della prima emergenza in attesa sulla propria strada
+
+// Latenze dei veicoli della propria strada (comando seriale LAT)
+static latency_hist_t lat_recv = {"pressione-ricezione"};
+static latency_hist_t lat_wait = {"ricezione-decisione"};
+static latency_hist_t lat_green = {"decisione-verde"};
+static latency_hist_t lat_total = {"pressione-verde"};
+static latency_hist_t lat_preempt = {"emergenza pressione-verde"};
+
+// Code delle due strade tradotte in movimenti: il verde va a chi viene servito dall'arbitro
+static bool arbitrate(void){
+
+	movement_set_t normal = 0, emergency = 0;
+
+	if(my_queue.emergency != 0)
+		emergency |= my_movement;
+	else if(my_queue.normal != 0)
+		normal |= my_movement;
+
+	if(its_queue.emergency != 0)
+		emergency |= its_movement;
+	else if(its_queue.normal != 0)
+		normal |= its_movement;
+
+	return (arbiter_decide(normal, emergency) & my_movement) != 0;
+
+}
 
 static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8_t seqno){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message received from %d.%d\n", from->u8[0], from->u8[1]);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_RECV, from->u8[0], seqno, its_msg_type());
+	link_stats_rx(from);
+	// Ritrasmissione di un pacchetto già elaborato (ack perso)
+	if(dup_filter_check(from, seqno)){
+		ITS_LOG_DBG(RADIO, RUNICAST_DUP, from->u8[0], seqno, dup_filter_dropped());
+		return;
+	}
 }
 
 static void sent_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message sent to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_SENT, to->u8[0], retransmissions);
+	tx_queue_done(to, retransmissions, 1);
 }
 
-static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){}
+static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
+	ITS_LOG_ERR(RADIO, RUNICAST_TIMEOUT, to->u8[0]);
+	tx_queue_done(to, retransmissions, 0);
+}
 
 static const struct runicast_callbacks runicast_calls = {recv_runicast, sent_runicast, timedout_runicast};
 static struct runicast_conn runicast;
 
-static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){
+// Report di un G* (nuovo veicolo o upgrade a emergenza) sulla propria strada o sull'altra: i conteggi
+// cumulativi recuperano anche i veicoli dei report persi
+static void road_arrival(bool mine, const its_msg_notify_t *msg, const its_msg_upgrade_t *upgrade){
 
-	#ifdef DEBUG
-		printf("DEBUG: broadcast message received from %d.%d\n", from->u8[0], from->u8[1]);
-	#endif
+	const its_msg_count_t *count = msg != NULL ? &msg->count : &upgrade->count;
+	uint16_t age = msg != NULL ? msg->age : upgrade->age;
+	uint8_t vehicle = msg != NULL ? msg->vehicle : EMERGENCY;
+	uint8_t arrivals, emergencies = my_queue.emergency;
 
-	// La funzione riceve un msg broadcast inviato dall'auto
-	if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr) && linkaddr_cmp(from, &tl2_addr) == 0){
-		
-		if(linkaddr_cmp(from, &g1_addr))
-			my_vehicle = atoi((char *) packetbuf_dataptr());
-		else
-			its_vehicle = atoi((char *) packetbuf_dataptr());
+	if(!mine){
+		arrivals = vehicle_queue_reconcile(&its_queue, &its_count, count->normal, count->emergency, count->boot, vehicle);
+		while(arrivals-- > 0)
+			phase_timing_arrival(&its_timing);
+		return;
+	}
 
-		state = MANAGE_TRAFFIC;
-		process_post(&tl, PROCESS_EVENT_MSG, NULL);
+	arrivals = vehicle_queue_reconcile(&my_queue, &my_count, count->normal, count->emergency, count->boot, vehicle);
+	if(arrivals > 0 && msg != NULL){	// Latenze solo per il veicolo del report: dei recuperati non si conosce la pressione
+		latency_add(&lat_recv, msg->age);
+		latency_pending_push(&my_pending, clock_time() - msg->age, clock_time());
+	}
+	while(arrivals-- > 0)
+		phase_timing_arrival(&my_timing);
+	if(emergencies == 0 && my_queue.emergency != 0)
+		emergency_press = clock_time() - age;
 
-	} else if(linkaddr_cmp(&linkaddr_node_addr, &tl2_addr) && linkaddr_cmp(from, &tl1_addr) == 0){
+}
 
-		if(linkaddr_cmp(from, &g2_addr))
-			my_vehicle = atoi((char *) packetbuf_dataptr());
-		else
-			its_vehicle = atoi((char *) packetbuf_dataptr());
+static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){
 
-		state = MANAGE_TRAFFIC;
-		process_post(&tl, PROCESS_EVENT_MSG, NULL);
+	const its_msg_notify_t *msg = its_msg_get(ITS_MSG_VEHICLE, sizeof(*msg));
+	const its_msg_upgrade_t *upgrade = its_msg_get(ITS_MSG_UPGRADE, sizeof(*upgrade));
+	bool calm = my_queue.emergency == 0 && its_queue.emergency == 0;		// Nessuna emergenza in coda prima del report
 
-	}
+	ITS_LOG_DBG(RADIO, BROADCAST_RECV, from->u8[0], its_msg_type());
+	link_stats_rx(from);
+
+	if(msg == NULL && upgrade == NULL)		// Notifiche verso i G* dell'altro semaforo
+		return;
+
+	// La funzione riceve un msg broadcast inviato dall'auto
+	if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr) && linkaddr_cmp(from, &tl2_addr) == 0)
+		road_arrival(linkaddr_cmp(from, &g1_addr), msg, upgrade);
+	else if(linkaddr_cmp(&linkaddr_node_addr, &tl2_addr) && linkaddr_cmp(from, &tl1_addr) == 0)
+		road_arrival(linkaddr_cmp(from, &g2_addr), msg, upgrade);
+	else
+		return;
+
+	// Entrambi i semafori sentono la stessa emergenza e interrompono insieme la fase in corso;
+	// un upgrade rifà l'arbitraggio come un nuovo veicolo, ma se il veicolo è già passato le
+	// code non cambiano e la fase non viene interrotta
+	if(calm && (my_queue.emergency != 0 || its_queue.emergency != 0))
+		preempt = true;
+	state = MANAGE_TRAFFIC;
+	process_post(&tl_traffic, PROCESS_EVENT_MSG, NULL);
 
 }
 
 static void broadcast_sent(struct broadcast_conn *c, int status, int num_tx){
-	#ifdef DEBUG
-		printf("DEBUG: message sent in broadcast\n");
-	#endif
+	ITS_LOG_DBG(RADIO, BROADCAST_SENT, status, num_tx);
 }
 
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv, broadcast_sent}; 
 static struct broadcast_conn broadcast;
 
-PROCESS_THREAD(tl, ev, data){
+PROCESS_THREAD(tl_traffic, ev, data){
+
+	static struct etimer et;					// Timer per fare blinking ed attendere per il rosso/verde
 
-	static struct etimer et, sensing_timer, humidity_timer;		// et: timer per fare blinking ed attendere per il rosso/verde
-																// sensing_timer: timer per fare sensing ogni CLOCK_SEC * k secondi 
-	PROCESS_EXITHANDLER(runicast_close(&runicast));
 	PROCESS_EXITHANDLER(broadcast_close(&broadcast));
 
 	PROCESS_BEGIN();
 
-	static size_t battery_level = 100;			// Livello della batteria
-	static size_t counter_until_20 = 0;			// Contatore fino a 20 necessario quando sensing_timer ha frequenza CLOCK_SEC * 1
-	static bool red_tl_enable = false;			// Flag attivo quando si è evviata lo stato MANAGE_TRAFFIC e si setta et a CLOCK_SEC * 5  
-	static bool timer10_flag = false;			// Flag attivo quando sensing_timer è passato ha CLOCK_SEC * 10
-	static bool timer20_flag = false;			// Flag attivo quando sensing_timer deve campionare ogni 20 sec
-	static bool button_activated = false;		// Flag attivo quando battery_level <= 20
-	static bool et_expired = false;				// Flag attivo quando sensing_timer o et (in stato BLINK) scadono
-	static bool transmit = false;				// Flag per inviare umidità in differità
-	static int humidity = 0, temperature = 0;
-	static measurement_t sensing;				// Struct per salvare i valori di sensing
-	static linkaddr_t recv;
+	static bool red_tl_enable = false;			// Flag attivo quando si è evviata lo stato MANAGE_TRAFFIC e si setta et per il rosso/verde
+	static uint8_t i;
+	static its_msg_vehicle_t notify;			// Notifica di verde per il G*
 
-	runicast_open(&runicast, 144, &runicast_calls);
+	its_log_init();
 	broadcast_open(&broadcast, 150, &broadcast_call);
+	phase_timing_init(&my_timing);
+	phase_timing_init(&its_timing);
+
+	// Movimenti nel piano dell'incrocio: TL1 sull'approccio 0, TL2 sull'approccio 1
+	if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){
+		my_movement = ARBITER_MOVE(0, ARBITER_STRAIGHT);
+		its_movement = ARBITER_MOVE(1, ARBITER_STRAIGHT);
+	} else {
+		my_movement = ARBITER_MOVE(1, ARBITER_STRAIGHT);
+		its_movement = ARBITER_MOVE(0, ARBITER_STRAIGHT);
+	}
+
 	leds_on(LEDS_GREEN);
 	leds_off(LEDS_RED);
 	etimer_set(&et, CLOCK_SECOND);
-	etimer_set(&sensing_timer, CLOCK_SECOND * 5);
 
 	while(1){
 
-		PROCESS_WAIT_EVENT();
-
-		// Invia l'umidità dopo 500ms dall'invio della temperatura
-		if(transmit == true && etimer_expired(&humidity_timer) && !runicast_is_transmitting(&runicast)){
-			recv.u8[0] = G1_ADDR;
-			recv.u8[1] = 0;
-			transmit = false;
-			packetbuf_copyfrom(&sensing, sizeof(sensing));
-			runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
-		}
-
-		// Se sensing_timer o et (in stato = BLINK) sono scaduti e il pulsante non è stato ancora attivato ...
-		if(et_expired == true && button_activated == false){
+		// EVENTI:
+		//	- et scaduto (blink, fine del rosso/verde)
+		//	- veicolo ricevuto da un G*
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || ev == PROCESS_EVENT_MSG);
 
-			if(battery_level < 20 && button_activated == false){
-				SENSORS_ACTIVATE(button_sensor);
-				button_activated = true;
-			}
-			if(timer10_flag == false && battery_level <= 50){
-				etimer_set(&sensing_timer, CLOCK_SECOND * 10);
-				timer10_flag = true;
-			}else if(timer20_flag == false && battery_level <= 20){
-				etimer_set(&sensing_timer, CLOCK_SECOND);
-				timer20_flag = true;
-			}
-			et_expired = false;
-
-		}
+		// Preemption: MANAGE_TRAFFIC decide subito, senza attendere la fine del rosso/verde in corso
+		if(preempt){
 
-		// Quando il pulsante è stato attivato, e viene premuto ripristina lo stato di sensing del mote
-		if(button_activated == true && ev == sensors_event && data == &button_sensor){
+			ITS_LOG_INFO(TRAFFIC, PREEMPT, my_queue.emergency, its_queue.emergency);
 
-			battery_level = 100;
-			counter_until_20 = 0;
-			timer10_flag = false;
-			timer20_flag = false;
-			button_activated = false;
-			SENSORS_DEACTIVATE(button_sensor);
-			leds_off(LEDS_BLUE);
-			etimer_set(&sensing_timer, CLOCK_SECOND * 5);
-			continue;
+			preempt = false;
+			red_tl_enable = false;
 
 		}
 
 		if(state == BLINK && etimer_expired(&et)){
 
-			printf("STATO: BLINK\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_BLINK);
 
+			energy_acct_enter(ENERGY_BLINK);
 			leds_toggle(LEDS_GREEN);
 			leds_toggle(LEDS_RED);
-			battery_level = (int)(battery_level - 5) > 0 ? (battery_level - 5) : 0;
-			et_expired = true;
 			etimer_reset(&et);
 
 		}
 
-		// Quando scade sensing timer raccogli temperatura e umidità
-		if(etimer_expired(&sensing_timer)){
-
-			etimer_reset(&sensing_timer);
-			// se il pulsante è attivo significa che la batteria ha carica infereriore (<=) a 20
-			if(button_activated == true){
-				counter_until_20++;
-				leds_toggle(LEDS_BLUE);
-				if(counter_until_20 < 20 || battery_level <= 0)	// Non fa sensing, si rimanda quando counter = 20 o batteria sarà full
-					continue;
-				else
-					counter_until_20 = 0;
-			}
-
-			// Destinatario
-			recv.u8[0] = G1_ADDR;
-			recv.u8[1] = 0;
-
-			SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
-			et_expired = true;
-			battery_level = (int)(battery_level - 10) > 0 ? (battery_level - 10) : 0;
-
-			sensing.type = 'T';
-			sensing.value = (sht11_sensor.value(SHT11_SENSOR_TEMP)/10 - 396)/10;
-			temperature = sensing.value;
-
-			if(!runicast_is_transmitting(&runicast)) {
-				packetbuf_copyfrom(&sensing, sizeof(sensing));
-				runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
-			}
-			
-			sensing.type = 'H';
-			humidity = sht11_sensor.value(SHT11_SENSOR_HUMIDITY);
-			// Fix umidità
-			sensing.value = -4 + 0.0405 * humidity + (-2.8 * 0.000001) * (humidity * humidity);
-			sensing.value = (temperature - 25) * (0.01 + 0.00008 * humidity) + sensing.value;
-			SENSORS_DEACTIVATE(sht11_sensor);
-
-			transmit = true;
-			etimer_set(&humidity_timer, CLOCK_SECOND / HUMIDITY_SENS);
-
-			continue;
-
-		}
-
 		if((state == MANAGE_TRAFFIC && red_tl_enable == false ) || (state == MANAGE_TRAFFIC && red_tl_enable == true && etimer_expired(&et))){
 
-			printf("STATO: MANAGE_TRAFFIC\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_MANAGE_TRAFFIC);
 
+			energy_acct_enter(ENERGY_TRAFFIC);
 			red_tl_enable = true;
 
-			if(my_vehicle != NONE){
-
-				// ho la priorità se ho una qualunque auto e:
-				// - lui non ha macchine
-				// - lui ha auto normali
-				// - ho un auto di emergenza e lui anche
-				if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){ 							// Prioritario
-					if(its_vehicle != EMERGENCY || (my_vehicle == EMERGENCY && its_vehicle == EMERGENCY))
-						state = SEND_NOTIFY_CAR;
-					else
-						state = RED_TL;
-					
-				}
-
-				// ho la priorità se ho una qualunque auto e:
-				// - lui non ha macchine
-				// - ho un auto di emergenza e lui no
-				if(linkaddr_cmp(&linkaddr_node_addr, &tl2_addr)){				 		// NON prioritario
-					if(its_vehicle == NONE || (my_vehicle == EMERGENCY && its_vehicle != EMERGENCY))
-						state = SEND_NOTIFY_CAR;
-					else
-						state = RED_TL;
-				}
-
-			} else {
-
+			// Emergenza prima di tutto; a parità di veicolo vince la fase che viene prima nel piano (TL1)
+			if(!vehicle_queue_empty(&my_queue) && arbitrate()){
+				decision = clock_time();
+				state = SEND_NOTIFY_CAR;
+			} else
 				state = RED_TL;
 
-			}
-
 		}
 
 		if(state == RED_TL){
 
-			printf("STATO: RED_TL\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_RED_TL);
 
-			its_vehicle = NONE;
-			if(my_vehicle == NONE)
+			energy_acct_enter(ENERGY_TRAFFIC);
+			etimer_set(&et, phase_timing_green(&its_timing, &its_queue));	// Il rosso dura quanto il verde dell'altra strada
+			phase_timing_served(&its_timing, &its_queue);
+			vehicle_queue_clear(&its_queue);		// L'altra strada è al verde e scarica la sua coda
+			if(vehicle_queue_empty(&my_queue))
 				state = RESTORE_TL;
 			else
 				state = MANAGE_TRAFFIC;
 			leds_on(LEDS_RED);
 			leds_off(LEDS_GREEN);
-			etimer_set(&et, CLOCK_SECOND * 5);
 			continue;
 		}
 
 		if(state == SEND_NOTIFY_CAR){ // Dico sì alla macchinuccia
 
-			printf("STATO: SEND_NOTIFY_CAR\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_SEND_NOTIFY_CAR);
 
-			packetbuf_copyfrom("0", 2);
+			energy_acct_enter(ENERGY_TRAFFIC);
+			its_msg_init(&notify.hdr, ITS_MSG_GREEN);
+			notify.vehicle = vehicle_queue_top(&my_queue);
+			notify.age = clock_time() - decision;
+			packetbuf_copyfrom(&notify, sizeof(notify));
 			broadcast_send(&broadcast);
 			state = GREEN_TL;
 
@@ -305,27 +300,41 @@ PROCESS_THREAD(tl, ev, data){
 
 		if(state == GREEN_TL){
 
-			printf("STATO: GREEN_TL\n");
-
-			my_vehicle = NONE;			
+			ITS_LOG_INFO(TRAFFIC, STATE_GREEN_TL, vehicle_queue_length(&my_queue));
+
+			energy_acct_enter(ENERGY_GREEN);
+			etimer_set(&et, phase_timing_green(&my_timing, &my_queue));	// Il verde termina quando la coda è smaltita
+			if(my_queue.emergency != 0)		// Prima di svuotare la coda
+				latency_add(&lat_preempt, clock_time() - emergency_press);
+			phase_timing_served(&my_timing, &my_queue);
+			vehicle_queue_clear(&my_queue);		// Un solo verde serve tutti i veicoli in coda
+			for(i = 0; i < my_pending.count; i++){
+				latency_add(&lat_wait, decision - my_pending.recv[i]);
+				latency_add(&lat_total, clock_time() - my_pending.press[i]);
+			}
+			latency_add(&lat_green, clock_time() - decision);
+			latency_pending_clear(&my_pending);
+			ITS_LOG_INFO(TRAFFIC, TRAFFIC_STATS, my_timing.served, phase_timing_avg_wait(&my_timing), phase_timing_rate(&my_timing));
 			leds_on(LEDS_GREEN);
 			leds_off(LEDS_RED);
-			if(its_vehicle == NONE)
+			if(vehicle_queue_empty(&its_queue))
 				state = RESTORE_TL;
 			else
 				state = MANAGE_TRAFFIC;
-			etimer_set(&et, CLOCK_SECOND * 5);
 			continue;
 		}
 
 		if(state == RESTORE_TL && etimer_expired(&et)){
 
-			printf("STATO: RESTORE_TL\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_RESTORE_TL);
 
 			state = BLINK;
 			red_tl_enable = false;
-			my_vehicle = NONE;
-			its_vehicle = NONE;
+			vehicle_queue_clear(&my_queue);
+			vehicle_queue_clear(&its_queue);
+			phase_timing_discard(&my_timing);
+			phase_timing_discard(&its_timing);
+			latency_pending_clear(&my_pending);
 			leds_toggle(LEDS_GREEN);
 			leds_toggle(LEDS_RED);
 			etimer_set(&et, CLOCK_SECOND * 1);
@@ -336,4 +345,167 @@ PROCESS_THREAD(tl, ev, data){
 
 	PROCESS_END();
 
-}
\ No newline at end of file
+}
+
+PROCESS_THREAD(tl_sensing, ev, data){
+
+	static struct etimer sensing_timer;			// Timer per fare sensing con la cadenza corrente
+
+	PROCESS_EXITHANDLER(runicast_close(&runicast));
+
+	PROCESS_BEGIN();
+
+	static sensing_input_t input;				// Stato del nodo passato alla politica di campionamento
+	static sensing_stats_t stats;				// Media e varianza recenti della temperatura
+	static clock_time_t interval;				// Intervallo scelto dalla politica, 0 se il sensing è sospeso
+	static sample_t sensing;					// Ultima misura di temperatura e umidità
+	static sample_batch_t batch;				// Misure in attesa di invio a G1
+	static its_msg_batch_t upload;				// Frame del batch
+	static deadband_t deadband;					// Ultima misura inviata a G1
+	static uint8_t previous;					// Stato energetico interrotto dal sensing
+	static linkaddr_t recv;
+
+	runicast_open(&runicast, 144, &runicast_calls);
+	tx_queue_open(&runicast);
+
+	// Destinatario
+	recv.u8[0] = G1_ADDR;
+	recv.u8[1] = 0;
+
+	interval = SENSING_POLICY_MIN;
+	etimer_set(&sensing_timer, interval);
+	printf("SENSING: politica %s\n", SENSING_POLICY.name);
+
+	while(1){
+
+		// EVENTI:
+		//	- sensing_timer scaduto
+		//	- poll da tl_energy quando la batteria viene sostituita
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || ev == PROCESS_EVENT_POLL);
+
+		if(ev == PROCESS_EVENT_TIMER && interval != 0){
+
+			previous = energy_acct_enter(ENERGY_SENSING);
+			SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
+
+			// Temperatura e umidità viaggiano nello stesso batch
+			sensing.temperature = sht11_conv_temperature(sht11_sensor.value(SHT11_SENSOR_TEMP));
+			sensing.humidity = sht11_conv_humidity(sht11_sensor.value(SHT11_SENSOR_HUMIDITY), sensing.temperature);
+			SENSORS_DEACTIVATE(sht11_sensor);
+
+			// La misura entra nel batch solo se è cambiata o per heartbeat; G1 tiene valida l'ultima ricevuta
+			if(deadband_changed(&deadband, sensing.temperature, sensing.humidity)){
+				sample_batch_add(&batch, sensing.temperature, sensing.humidity);
+				deadband_sent(&deadband, sensing.temperature, sensing.humidity);
+			}
+
+			// Buffer pieno o misura più vecchia in scadenza: un solo frame per tutte le misure accumulate.
+			// Con un batch ancora in coda le misure restano nel buffer e partono nel frame successivo
+			if(sample_batch_due(&batch) && tx_queue_pending(TX_QUEUE_TELEMETRY) == 0)
+				tx_queue_push(TX_QUEUE_TELEMETRY, &recv, &upload, sample_batch_encode(&batch, &upload));
+			energy_acct_enter(previous);
+			sensing_stats_add(&stats, sensing.temperature);
+
+		}
+
+		// La politica sceglie il prossimo intervallo; con il sensing sospeso si ricontrolla dopo SENSING_POLICY_MAX
+		input.level = energy_acct_level();
+		input.variance = stats.variance;
+		input.activity = phase_timing_activity(&my_timing);
+		interval = SENSING_POLICY.next_interval(&input);
+		etimer_set(&sensing_timer, interval != 0 ? interval : SENSING_POLICY_MAX);
+
+	}
+
+	PROCESS_END();
+
+}
+
+PROCESS_THREAD(tl_energy, ev, data){
+
+	static struct etimer energy_timer;			// Aggiornamento periodico della contabilità energetica
+
+	PROCESS_EXITHANDLER(broadcast_close(&energy_broadcast));
+
+	PROCESS_BEGIN();
+
+	static bool button_activated = false;		// Flag attivo quando la carica è < 20 %: il pulsante segnala la batteria sostituita
+	static uint8_t level = 100;					// Carica residua stimata, %
+	static uint8_t updates = 0;					// Aggiornamenti dall'ultimo report
+	static its_msg_energy_t report;				// Report dei consumi per stato verso G1
+
+	energy_acct_init();
+	broadcast_open(&energy_broadcast, ITS_MSG_ENERGY_CHANNEL, &energy_call);
+	etimer_set(&energy_timer, CLOCK_SECOND * ENERGY_PERIOD);
+
+	while(1){
+
+		// EVENTI:
+		//	- energy_timer scaduto
+		//	- bottone (solo con batteria scarica)
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || (ev == sensors_event && data == &button_sensor));
+
+		// Quando il pulsante è stato attivato, e viene premuto ripristina lo stato di sensing del mote
+		if(ev == sensors_event){
+
+			if(button_activated == false)
+				continue;
+			energy_acct_recharge();
+			button_activated = false;
+			SENSORS_DEACTIVATE(button_sensor);
+			leds_off(LEDS_BLUE);
+			process_poll(&tl_sensing);	// Riprende subito il sensing se era sospeso
+
+		} else {
+
+			etimer_reset(&energy_timer);
+			energy_acct_update();
+
+			if(++updates == ENERGY_REPORT_EVERY){
+				updates = 0;
+				energy_acct_report(&report, ENERGY_PERIOD * ENERGY_REPORT_EVERY);
+				packetbuf_copyfrom(&report, sizeof(report));
+				broadcast_send(&energy_broadcast);
+			}
+
+		}
+
+		level = energy_acct_level();
+		if(level < 20 && button_activated == false){
+			SENSORS_ACTIVATE(button_sensor);
+			leds_on(LEDS_BLUE);		// Batteria scarica: blu acceso fino alla sostituzione
+			button_activated = true;
+		}
+
+	}
+
+	PROCESS_END();
+
+}
+
+PROCESS_THREAD(tl_serial, ev, data){
+
+	PROCESS_BEGIN();
+
+	while(1){
+
+		// EVENTI:
+		//	- comando da seriale
+		PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message);
+
+		if(!strcmp((char *) data, "LAT")){
+			latency_print(&lat_recv);
+			latency_print(&lat_wait);
+			latency_print(&lat_green);
+			latency_print(&lat_total);
+			latency_print(&lat_preempt);
+			printf("DUP: scartati %u\n", dup_filter_dropped());
+		}
+		if(!strcmp((char *) data, "LINKS"))
+			link_stats_print();
+
+	}
+
+	PROCESS_END();
+
+}
@@ -6,11 +6,27 @@
 #include "sys/etimer.h"
 #include "net/rime/rime.h"
 #include "stdio.h"
+#include "string.h"
+#include "its-msg.h"
+#include "sht11-conv.h"
+#include "sink-table.h"
+#include "energy-acct.h"
+#include "latency.h"
+#include "its-log.h"
+#include "dup-filter.h"
+#include "link-stats.h"
+#include "tx-queue.h"
+#include "sample-batch.h"
+
+// Un batch arriva fino a SAMPLE_BATCH_DEADLINE dopo la sua prima misura: una finestra più corta
+// si chiuderebbe prima che i nodi a lotti riportino, abbassando la copertura
+#if SINK_TABLE_WINDOW < CLOCK_SECOND * SAMPLE_BATCH_DEADLINE
+	#error "SINK_TABLE_WINDOW deve coprire SAMPLE_BATCH_DEADLINE"
+#endif
 
 //#define COOJA
-#define DEBUG
 
-#ifdef COOJA
+#if defined(COOJA) || defined(CONTIKI_TARGET_NATIVE)	// Cooja e simulatore native (sim/run-native.sh)
 	#define G1_ADDR 		1 	
 	#define G2_ADDR 		2	
 	#define TL1_ADDR 		3   
@@ -25,14 +41,9 @@
 #define bool 				char 
 #define true 				1
 #define false 				0
-#define MAX_RETRANSMISSIONS 5
-#define SIZE 				4
+#define ENERGY_PERIOD		60		// Secondi fra due stampe dei consumi di G1
 #define MAX_CHARSET			25
-
-typedef struct {
-	char type;
-	int value;
-} measurement_t;
+#define HISTORY_SIZE		3		// Batch ricevuti in attesa di essere stampati come STORICO
 
 typedef enum { NONE, NORMAL, EMERGENCY } vehicle_t;
 typedef enum { DEFAULT, NOTIFY_VEHICLE, RESTORE_VEHICLE } state_t;
@@ -40,137 +51,233 @@ typedef enum { DEFAULT, NOTIFY_VEHICLE, RESTORE_VEHICLE } state_t;
 PROCESS(g1, "G1 SkyMote");
 AUTOSTART_PROCESSES(&g1);
 
-static const linkaddr_t g2_addr = {{G2_ADDR,0}};				// Strutture contenenti l'indirizzo dei Mote
-static const linkaddr_t tl1_addr = {{TL1_ADDR,0}};
-static const linkaddr_t tl2_addr = {{TL2_ADDR,0}};
-static int temperature[SIZE], humidity[SIZE];					// Array contenenti le informazioni di sensing dei 4 mote, temp/hum memorizza 
-static int local_temperature = -100, local_humidity = 0;		// Variabili temporanee per fixare il valore dell'umidità relativa
-static bool temp_from_g2 = false, temp_from_tl1 = false, temp_from_tl2 = false;	// Flag che tengono traccia delle trasmissioni di sensing
-static bool hum_from_g2 = false, hum_from_tl1 = false, hum_from_tl2 = false;	// Buffer di testo per il messaggio di warning
+static const linkaddr_t tl1_addr = {{TL1_ADDR,0}};				// Strutture contenenti l'indirizzo dei Mote
 static char warning_message[MAX_CHARSET];						// Buffer di testo per il messaggio di warning
 static state_t state = DEFAULT;									// Variabile che tiene lo stato della macchina (Mote)
+static clock_time_t press;						// Prima pressione del veicolo in classificazione
+static latency_pending_t pending;				// Veicoli notificati in attesa del verde
+static its_msg_batch_t history[HISTORY_SIZE];	// Batch ricevuti, stampati come STORICO da g1 fuori dalla callback
+static linkaddr_t history_from[HISTORY_SIZE];
+static uint8_t history_head = 0, history_count = 0;
+static uint16_t history_lost = 0;				// Batch non accodati, con lo storico pieno
+static int32_t window_temperature, window_humidity;	// Somme dell'ultima finestra chiusa, mediate da g1
+static uint8_t window_nodes, window_count;				// Nodi sommati e registrati nella finestra
+static bool window_pending = false;
+
+// Latenze dei veicoli di questo sensore (comando seriale LAT)
+static latency_hist_t lat_notify = {"pressione-notifica"};
+static latency_hist_t lat_tl = {"decisione-notifica TL"};
+static latency_hist_t lat_total = {"pressione-verde"};
+
+// Verde dal proprio TL: serve tutti i veicoli notificati finora
+static void green_received(void){
+
+	const its_msg_vehicle_t *green = its_msg_get(ITS_MSG_GREEN, sizeof(*green));
+	uint8_t i;
+
+	if(green == NULL)
+		return;
+	latency_add(&lat_tl, green->age);
+	for(i = 0; i < pending.count; i++)
+		latency_add(&lat_total, clock_time() - pending.press[i]);
+	latency_pending_clear(&pending);
+
+}
+
+static void print_latency(void){
+	latency_print(&lat_notify);
+	latency_print(&lat_tl);
+	latency_print(&lat_total);
+	printf("DUP: scartati %u\n", dup_filter_dropped());
+}
 
 static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8_t seqno){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message received from %d.%d, seqno %d, msg: %s\n", from->u8[0], from->u8[1], seqno, (char *)packetbuf_dataptr());
-	#endif
-	state = RESTORE_VEHICLE;
-	process_post(&g1, PROCESS_EVENT_MSG, NULL);
+	ITS_LOG_DBG(RADIO, RUNICAST_RECV, from->u8[0], seqno, its_msg_type());
+	link_stats_rx(from);
+	// Ritrasmissione di un pacchetto già elaborato (ack perso)
+	if(dup_filter_check(from, seqno)){
+		ITS_LOG_DBG(RADIO, RUNICAST_DUP, from->u8[0], seqno, dup_filter_dropped());
+		return;
+	}
+	// Il verde scarica la coda del semaforo: il sensore è già pronto per il prossimo veicolo
+	if(its_msg_type() == ITS_MSG_GREEN){
+		ITS_LOG_INFO(TRAFFIC, GREEN, 1);
+		green_received();
+	}
 }
 
 static void sent_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message sent to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_SENT, to->u8[0], retransmissions);
+	tx_queue_done(to, retransmissions, 1);
 }
 
 static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	printf("//// Timeout\n");
-	state = RESTORE_VEHICLE;
-	process_post(&g1, PROCESS_EVENT_MSG, NULL);
+	ITS_LOG_ERR(RADIO, RUNICAST_TIMEOUT, to->u8[0]);
+	tx_queue_done(to, retransmissions, 0);
 }
 
 static const struct runicast_callbacks runicast_calls = {recv_runicast, sent_runicast, timedout_runicast};
 static struct runicast_conn runicast;
 
-static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){
+// Chiusura di una finestra di aggregazione, anche dalla callback di ricezione: salva solo le
+// somme dei nodi, perché la tabella viene azzerata subito dopo, e lascia a g1 sensing e stampa
+static void window_closed(void){
+	window_nodes = sink_table_sum(&window_temperature, &window_humidity);
+	window_count = sink_table_count();
+	window_pending = true;
+	process_poll(&g1);
+}
 
-	#ifdef DEBUG
-		printf("DEBUG: broadcast received from %d.%d\n", from->u8[0], from->u8[1]);
-	#endif
+// Media dell'ultima finestra chiusa sui nodi che hanno riportato più la misura di G1, calcolata da g1
+static void print_window(void){
 
-	static size_t index;									// Indice usato nel for
+	static uint8_t nodes;									// Nodi che contribuiscono alla media
 	static int temperature_avg = 0, humidity_avg = 0;		// Variabili locali per il calcolo del valore medio
-	static measurement_t sensing;							// Struttura di appoggio per le informazioni ricevute
+	static int16_t local_temperature, local_humidity;		// Misure di G1
+	static uint8_t previous;								// Stato energetico interrotto dal sensing
 
-	memcpy(&sensing, packetbuf_dataptr(), sizeof(sensing));
+	previous = energy_acct_enter(ENERGY_SENSING);
+	SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
+	local_temperature = sht11_conv_temperature(sht11_sensor.value(SHT11_SENSOR_TEMP));
+	local_humidity = sht11_conv_humidity(sht11_sensor.value(SHT11_SENSOR_HUMIDITY), local_temperature);
+	SENSORS_DEACTIVATE(sht11_sensor);
+	energy_acct_enter(previous);
 
-	if(linkaddr_cmp(from,&g2_addr)){						// Controllo da chi proviene il pacchetto e setto il flag del dato
-		if(sensing.type == 'T'){
-			temperature[1] = sensing.value;
-			temp_from_g2 = true;
-		} else {
-			humidity[1] = sensing.value;
-			hum_from_g2 = true;
-		}
-	} else if(linkaddr_cmp(from,&tl1_addr)){
-		if(sensing.type == 'T'){
-			temperature[2] = sensing.value;
-			temp_from_tl1 = true;
-		} else {
-			humidity[2] = sensing.value;
-			hum_from_tl1 = true;
-		}
-	} else { // if(linkaddr_cmp(from,&tl2_addr))
-		if(sensing.type == 'T'){
-			temperature[3] = sensing.value;
-			temp_from_tl2 = true;
-		} else {
-			humidity[3] = sensing.value;
-			hum_from_tl2 = true;
+	nodes = window_nodes + 1;	// +1: la misura di G1
+	temperature_avg = (window_temperature + local_temperature) / nodes;
+	humidity_avg = (window_humidity + local_humidity) / nodes;
+
+	if(strlen(warning_message) != 0)
+		printf("%s\n", warning_message);
+	printf("TEMP: %d°C\tHUMIDITY: %d%%\tCOVERAGE: %d/%d\n", temperature_avg, humidity_avg, nodes, window_count + 1);
+
+	memset(warning_message, '\0', 25);
+	window_pending = false;
+
+}
+
+// Storico dei batch accodati, stampato dal processo: sulla seriale fino a ITS_MSG_BATCH_MAX righe per batch
+static void print_history(void){
+
+	const its_msg_batch_t *batch;
+	const linkaddr_t *from;
+	sample_t sample;
+	uint8_t i;
+
+	for(; history_count > 0; history_count--, history_head = (history_head + 1) % HISTORY_SIZE){
+		batch = &history[history_head];
+		from = &history_from[history_head];
+		for(i = 0; i < batch->count; i++){
+			sample_batch_decode(batch, i, &sample);
+			printf("STORICO: %d.%d\tt %u\tTEMP: %d°C\tHUMIDITY: %d%%\n", from->u8[0], from->u8[1], sample.timestamp, sample.temperature, sample.humidity);
 		}
 	}
+	if(history_lost > 0){
+		printf("STORICO: %u batch persi\n", history_lost);
+		history_lost = 0;
+	}
 
-	// Se ho ricevuto tutte le temperature o umidità, calcolo la media e stampo le informazioni
-	if((temp_from_g2 && temp_from_tl1 && temp_from_tl2) || (hum_from_g2 && hum_from_tl1 && hum_from_tl2)){
-
-		SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
-		if(temp_from_g2 && temp_from_tl1 && temp_from_tl2){
-			temperature[0] = (sht11_sensor.value(SHT11_SENSOR_TEMP)/10 - 396)/10;
-			local_temperature = temperature[0];
-		}else{
-			// Fix umidità: http://tinyos.stanford.edu/tinyos-wiki/index.php/Boomerang_ADC_Example
-			// Volendo si potrebbe fare prima la media di temperatura ed umidità, e correggere l'umidità di conseguenza con
-			// la temperatura media, così da ridurre ulteriormente la complessità
-			local_humidity = sht11_sensor.value(SHT11_SENSOR_HUMIDITY);
-			humidity[0] = -4 + 0.0405 * local_humidity + (-2.8 * 0.000001) * (local_humidity * local_humidity);
-			if(local_temperature != -100)
-				humidity[0] = (local_temperature - 25) * (0.01 + 0.00008 * local_humidity) + humidity[0];
-		}
-		SENSORS_DEACTIVATE(sht11_sensor);
+}
 
-		for(index = 0; index < 4; index++){
-			if(temp_from_g2 && temp_from_tl1 && temp_from_tl2)
-				temperature_avg += temperature[index]; 
-			else 
-				humidity_avg += humidity[index];
-		}
-		temperature_avg /= SIZE;
-		humidity_avg /= SIZE;
-
-		if(strlen(warning_message) != 0)
-			printf("%s\n", warning_message);
-		if(temp_from_g2 && temp_from_tl1 && temp_from_tl2){
-			printf("TEMP: %d°C\t", temperature_avg);
-			temp_from_tl2 = false; temp_from_tl1 = false; temp_from_g2 = false;
-		} else {
-			printf("HUMIDITY: %d%%\n", humidity_avg);
-			hum_from_tl2 = false; hum_from_tl1 = false; hum_from_g2 = false;
-		}
+// Misure di un nodo: ITS_MSG_SENSE singola o ITS_MSG_BATCH con più misure a differenze.
+// Le misure precedenti di un batch finiscono solo nello STORICO: nella tabella entra
+// l'ultima, con la sua epoca, così la finestra corrente viene toccata una volta e la
+// media non usa misure vecchie. La finestra copre la scadenza dei batch, quindi ogni
+// nodo con misure in attesa vi riporta; la media viene stampata da print_window()
+static void sense_recv(const linkaddr_t *from){
 
-		memset(warning_message, '\0', 25);
+	const its_msg_sense_t *sensing;							// Misura ricevuta, letta direttamente dal packetbuf
+	const its_msg_batch_t *batch;
+	sample_t sample;
+	uint8_t i;
+
+	if(its_msg_type() == ITS_MSG_SENSE){
+
+		sensing = its_msg_get(ITS_MSG_SENSE, sizeof(*sensing));
+		if(sensing == NULL)
+			return;
+
+		ITS_LOG_DBG(RADIO, SENSE_RECV, from->u8[0], sensing->epoch, 1);
+
+		if(sink_table_report(from, sensing->epoch, sensing->temperature, sensing->humidity) == SINK_TABLE_FULL)
+			ITS_LOG_ERR(RADIO, SINK_FULL, from->u8[0]);
+		return;
 
 	}
 
+	batch = its_msg_get(ITS_MSG_BATCH, its_msg_batch_size(1));
+	if(batch == NULL || batch->count == 0 || batch->count > ITS_MSG_BATCH_MAX || packetbuf_datalen() < its_msg_batch_size(batch->count))
+		return;
+
+	ITS_LOG_DBG(RADIO, SENSE_RECV, from->u8[0], batch->epoch, batch->count);
+
+	// Lo storico viene stampato da g1; con la coda piena il batch viene solo contato
+	if(history_count < HISTORY_SIZE){
+		i = (history_head + history_count++) % HISTORY_SIZE;
+		memcpy(&history[i], batch, its_msg_batch_size(batch->count));
+		linkaddr_copy(&history_from[i], from);
+	}else
+		history_lost++;
+	process_poll(&g1);
+
+	sample_batch_decode(batch, batch->count - 1, &sample);
+	if(sink_table_report(from, batch->epoch + batch->count - 1, sample.temperature, sample.humidity) == SINK_TABLE_FULL)
+		ITS_LOG_ERR(RADIO, SINK_FULL, from->u8[0]);
+
+}
+
+static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){
+
+	ITS_LOG_DBG(RADIO, BROADCAST_RECV, from->u8[0], its_msg_type());
+	link_stats_rx(from);
+
+	sense_recv(from);
+
 }
 
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv}; 
 static struct broadcast_conn broadcast;
 
+// Consumi per stato (mC nel periodo), radio accesa (per mille) e carica residua di un nodo
+static void print_energy(const linkaddr_t *node, uint8_t level, uint8_t period, uint16_t radio, const uint16_t *charge){
+	printf("ENERGY: %d.%d\tLIVELLO %u%%\tRADIO %u.%u%%\tmC/%us IDLE %u BLINK %u TRAFFIC %u GREEN %u SENSING %u NOTIFY %u\n",
+		node->u8[0], node->u8[1], level, radio / 10, radio % 10, period, charge[ENERGY_IDLE], charge[ENERGY_BLINK],
+		charge[ENERGY_TRAFFIC], charge[ENERGY_GREEN], charge[ENERGY_SENSING], charge[ENERGY_NOTIFY]);
+}
+
+static void energy_recv(struct broadcast_conn *c, const linkaddr_t *from){
+
+	const its_msg_energy_t *report = its_msg_get(ITS_MSG_ENERGY, sizeof(*report));
+	uint16_t charge[ENERGY_ACCT_STATES], radio;
+
+	if(report == NULL)
+		return;
+	memcpy(charge, report->charge, sizeof(charge));		// Il messaggio è packed: copia allineata
+	memcpy(&radio, &report->radio, sizeof(radio));
+	print_energy(from, report->level, report->period, radio, charge);
+
+}
+
+static const struct broadcast_callbacks energy_call = {energy_recv};
+static struct broadcast_conn energy_broadcast;			// Report di energia di G2, TL1, TL2 (ITS_MSG_ENERGY_CHANNEL)
+
 PROCESS_THREAD(g1, ev, data){
 
-	static struct etimer double_press_timer, waiting_notify_timer;
+	static struct etimer double_press_timer, energy_timer;
 
 	PROCESS_EXITHANDLER(runicast_close(&runicast));
 	PROCESS_EXITHANDLER(broadcast_close(&broadcast));
+	PROCESS_EXITHANDLER(broadcast_close(&energy_broadcast));
 
 	PROCESS_BEGIN();
 
-	static bool tl_notified = false;
-	static bool etimer_active = false;
 	static bool auth = false;
 	static size_t msg_size, i;
-	static char message[2];
+	static its_msg_energy_t report;			// Consumi di G1 dall'ultima stampa
+	static uint16_t charge[ENERGY_ACCT_STATES], radio;
+	static its_msg_notify_t message;
+	static its_msg_upgrade_t upgrade;		// Upgrade a emergenza del veicolo notificato
+	static its_msg_count_t count = {0, 0, 0};	// Veicoli contati dall'avvio, per classe
 	static vehicle_t vehicle = NONE;
 	static linkaddr_t recv;
 
@@ -178,8 +285,14 @@ PROCESS_THREAD(g1, ev, data){
 	recv.u8[0] = TL1_ADDR;
 	recv.u8[1] = 0;
 
+	sink_table_init(window_closed);
 	runicast_open(&runicast, 144, &runicast_calls);
+	tx_queue_open(&runicast);
 	broadcast_open(&broadcast, 150, &broadcast_call);
+	broadcast_open(&energy_broadcast, ITS_MSG_ENERGY_CHANNEL, &energy_call);
+	energy_acct_init();
+	its_log_init();
+	etimer_set(&energy_timer, CLOCK_SECOND * ENERGY_PERIOD);
 	SENSORS_ACTIVATE(button_sensor);
 
 	while(1){
@@ -188,11 +301,42 @@ PROCESS_THREAD(g1, ev, data){
 		//	- bottone
 		//	- timer scaduto
 		//	- ricezione msg da tl
+		//	- poll: finestra chiusa o storico di un batch da stampare
 		PROCESS_WAIT_EVENT();
 
-		// Eventi legati al cmd: login e settaggio warning
+		if(ev == PROCESS_EVENT_POLL){
+			if(window_pending)
+				print_window();
+			if(history_count > 0 || history_lost > 0)
+				print_history();
+			continue;
+		}
+
+		// Consumi di G1: stampati localmente, G1 è il sink
+		if(ev == PROCESS_EVENT_TIMER && data == &energy_timer){
+
+			etimer_reset(&energy_timer);
+			energy_acct_update();
+			energy_acct_report(&report, ENERGY_PERIOD);
+			memcpy(charge, report.charge, sizeof(charge));
+			memcpy(&radio, &report.radio, sizeof(radio));
+			print_energy(&linkaddr_node_addr, report.level, report.period, radio, charge);
+			continue;
+
+		}
+
+		// Eventi legati al cmd: latenze, login e settaggio warning
 		if(ev == serial_line_event_message){
 
+			if(auth == false && !strcmp((char *) data, "LAT")){
+				print_latency();
+				continue;
+			}
+			if(auth == false && !strcmp((char *) data, "LINKS")){
+				link_stats_print();
+				continue;
+			}
+
 			if(auth == false){
 
 				if(!strcmp((char *) data, "NES\0")){
@@ -225,64 +369,62 @@ PROCESS_THREAD(g1, ev, data){
 		// Eventi legati al bottone
 		if(state == DEFAULT && ev == sensors_event && data == &button_sensor){
 
-			printf("STATO: DEFAULT\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_DEFAULT);
 
-			if(vehicle == NONE){
-
-				vehicle = NORMAL;
-				state = NOTIFY_VEHICLE;
-				etimer_set(&double_press_timer, CLOCK_SECOND * 0.5);
-				leds_on(LEDS_RED);
-				leds_off(LEDS_RED);
-				continue;
-		
-			}
+			leds_on(LEDS_RED);
+			leds_off(LEDS_RED);
 
+			// Seconda pressione entro la finestra: il veicolo appena notificato è un'emergenza
 			if(vehicle == NORMAL && etimer_expired(&double_press_timer) == 0){
-
-				leds_on(LEDS_RED);
-				leds_off(LEDS_RED);
 				vehicle = EMERGENCY;
+				count.normal--;
+				count.emergency++;
 				etimer_stop(&double_press_timer);
-				continue;
-
+			}else{	// Nuovo veicolo: notificato subito come normale, la finestra della doppia pressione resta aperta
+				press = clock_time();
+				vehicle = NORMAL;
+				count.normal++;
+				if(count.boot == 0)		// Avvio riconosciuto dai TL: tick della prima pressione, mai 0
+					count.boot = press % 255 + 1;
+				etimer_set(&double_press_timer, CLOCK_SECOND * 0.5);
 			}
+			state = NOTIFY_VEHICLE;
+			energy_acct_enter(ENERGY_NOTIFY);
 
 		}
 
-		// Timer scaduto per definire il veicolo: invio notifica al semaforo
-		if(state == NOTIFY_VEHICLE && tl_notified == false){
-
-			// Condizione necessaria nel caso il semaforo TL* abbia già ricevuto un veicolo da meno di 5 secondi.
-			if(etimer_active == false || (etimer_active == true && etimer_expired(&waiting_notify_timer))){
-
-				printf("STATO: NOTIFY_VEHICLE\n");
-
-				tl_notified = true;
-				SENSORS_DEACTIVATE(button_sensor);
-				sprintf(message, "%d", vehicle);
-				if(!runicast_is_transmitting(&runicast)) {
-					packetbuf_copyfrom(message, 2);
-					runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
-				}
-
+		// Notifica al semaforo: il nuovo veicolo o l'upgrade a emergenza dell'ultimo notificato
+		if(state == NOTIFY_VEHICLE){
+
+			ITS_LOG_INFO(TRAFFIC, STATE_NOTIFY_VEHICLE);
+
+			if(vehicle == EMERGENCY){
+				its_msg_init(&upgrade.hdr, ITS_MSG_UPGRADE);
+				upgrade.age = clock_time() - press;
+				upgrade.count = count;
+				// Se sorpassa la notifica in coda, i conteggi cumulativi la rendono un duplicato al TL
+				tx_queue_push(TX_QUEUE_EMERGENCY, &recv, &upgrade, sizeof(upgrade));
+			}else{
+				its_msg_init(&message.hdr, ITS_MSG_VEHICLE);
+				message.vehicle = vehicle;
+				message.age = clock_time() - press;
+				message.count = count;
+				latency_add(&lat_notify, message.age);
+				latency_pending_push(&pending, press, press);
+				// Con runicast occupato la notifica attende in coda, davanti alla telemetria
+				tx_queue_push(TX_QUEUE_NOTIFY, &recv, &message, sizeof(message));
 			}
-
-			continue;
+			state = RESTORE_VEHICLE;		// Il semaforo accoda il veicolo: non serve attendere il verde
 
 		}
 
-		// Ricezione msg dal semaforo
-		if(state == RESTORE_VEHICLE){ // Arriva l'okay dal semaforo
+		// Notifica inviata, pronto per il prossimo veicolo
+		if(state == RESTORE_VEHICLE){
 
-			printf("STATO: RESTORE_VEHICLE\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_RESTORE_VEHICLE);
 
-			state = DEFAULT;
-			vehicle = NONE;
-			tl_notified = false;
-			etimer_active = true;
-			etimer_set(&waiting_notify_timer, CLOCK_SECOND * 5);
-			SENSORS_ACTIVATE(button_sensor);
+			state = DEFAULT;		// vehicle resta NORMAL: una seconda pressione nella finestra è un upgrade
+			energy_acct_enter(ENERGY_IDLE);
 
 		}
 
@@ -0,0 +1,41 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+// G1 è il sink: riceve misure e report da tutti i nodi e pilota TL1, quindi
+// controlla il canale più spesso (latenza e ricezioni a raffica) e tiene più
+// frame in coda; resta comunque a batteria come gli altri G*.
+// Sovrascrivibile da bench/run.sh (BENCH_CHECK_RATE_<ruolo>) per confrontare le frequenze
+#ifdef ITS_CONF_CHECK_RATE
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	ITS_CONF_CHECK_RATE
+#else
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	16
+#endif
+#define QUEUEBUF_CONF_NUM			8
+
+#if CONTIKI_TARGET_NATIVE
+	// Radio simulata su UDP loopback (sim/sim-radio.c): sempre accesa, senza duty cycling
+	#define NETSTACK_CONF_RADIO		sim_radio_driver
+	#define NETSTACK_CONF_RDC			nullrdc_driver
+#else
+	// Duty cycling della radio: la radio resta spenta tra due controlli del canale
+	#define NETSTACK_CONF_MAC			csma_driver
+	#define NETSTACK_CONF_RDC			contikimac_driver
+	#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION	1	// Runicast: trasmette solo attorno al risveglio noto del vicino
+	// Seriale a interrupt: il drain del log (common/its-log.c) non attende la UART byte per byte
+	#define UART1_CONF_TX_WITH_INTERRUPT	1
+#endif
+
+// Solo Rime e messaggi ITS di poche decine di byte: buffer ridotti per liberare RAM
+#define PACKETBUF_CONF_SIZE			64
+
+// G2 e TL inviano solo su variazione, con heartbeat ogni 60 s (DEADBAND_HEARTBEAT):
+// l'ultima misura di un nodo resta valida per tre heartbeat (common/sink-table.h)
+#define SINK_TABLE_CONF_HOLD		180
+// I batch partono al più SAMPLE_BATCH_DEADLINE (30 s, common/sample-batch.h) dopo la loro
+// prima misura: la finestra di aggregazione copre la scadenza, così ogni nodo vi riporta
+#define SINK_TABLE_CONF_WINDOW		(CLOCK_SECOND * 32)
+
+// Contabilità energetica per stato (common/energy-acct.c)
+#define ENERGEST_CONF_ON			1
+
+#endif /* PROJECT_CONF_H_ */
@@ -7,15 +7,30 @@
 #include "dev/button-sensor.h"
 #include "dev/sht11/sht11-sensor.h"
 #include "dev/leds.h"
+#include "dev/serial-line.h"
 #include "sys/etimer.h"
 #include "net/rime/rime.h"
 #include "stdio.h"
 #include "stdlib.h"
+#include "string.h"
+#include "its-msg.h"
+#include "sht11-conv.h"
+#include "arbiter.h"
+#include "vehicle-queue.h"
+#include "phase-timing.h"
+#include "energy-acct.h"
+#include "deadband.h"
+#include "sample-batch.h"
+#include "sensing-policy.h"
+#include "latency.h"
+#include "its-log.h"
+#include "dup-filter.h"
+#include "link-stats.h"
+#include "tx-queue.h"
 
 //#define COOJA
-#define DEBUG
 
-#ifdef COOJA
+#if defined(COOJA) || defined(CONTIKI_TARGET_NATIVE)	// Cooja e simulatore native (sim/run-native.sh)
 	#define G1_ADDR 		1 	
 	#define G2_ADDR 		2	
 	#define TL1_ADDR 		3   
@@ -30,20 +45,25 @@
 #define bool 				char 
 #define true 				1
 #define false 				0
-#define MAX_RETRANSMISSIONS	5
+#define ENERGY_PERIOD		10		// Secondi fra due aggiornamenti della contabilità energetica
+#define ENERGY_REPORT_EVERY	6		// Aggiornamenti per report a G1
+#define DEMAND_RETRIES		3		// Ripetizioni di una DEMAND persa prima di rinunciare
+#define DEMAND_BACKOFF		(CLOCK_SECOND * 2)	// Attesa prima della prima ripetizione, raddoppiata a ogni tentativo
 
-typedef struct {
-	char type;
-	int value;
-} measurement_t;
-
-// Vehicle states, VOID is default state
-typedef enum { NONE, NORMAL, EMERGENCY, VOID } vehicle_t;
+// Vehicle states, NONE is default state
+typedef enum { NONE, NORMAL, EMERGENCY } vehicle_t;
 // TL state, BLINK is default state
 typedef enum { BLINK, SEND_NOTIFY_TL, MANAGE_TRAFFIC, SEND_NOTIFY_CAR, RED_TL, GREEN_TL, RESTORE_TL } state_t;
 
-PROCESS(tl,"TL SkyMote");
-AUTOSTART_PROCESSES(&tl);
+// Un processo per sottosistema: ognuno si sveglia solo per i propri timer ed eventi
+PROCESS(tl_traffic, "TL traffic");
+PROCESS(tl_sensing, "TL sensing");
+PROCESS(tl_energy, "TL energy");
+PROCESS(tl_serial, "TL serial");
+AUTOSTART_PROCESSES(&tl_traffic, &tl_sensing, &tl_energy, &tl_serial);
+
+static const struct broadcast_callbacks energy_call = {NULL};
+static struct broadcast_conn energy_broadcast;	// Report di energia verso G1 (ITS_MSG_ENERGY_CHANNEL)
 
 static const linkaddr_t g1_addr  = {{G1_ADDR, 0}};  	// Strutture contenenti l'indirizzo dei Mote
 static const linkaddr_t g2_addr = {{G2_ADDR, 0}};
@@ -52,19 +72,104 @@ static const linkaddr_t tl2_addr = {{TL2_ADDR, 0}};
 static bool tl_notified = false;		// Did other tl notify its vehicle?
 static struct runicast_conn runicast;
 static state_t state = BLINK;			
-static vehicle_t my_vehicle = NONE;		// State of my vehicle
-static vehicle_t its_vehicle = VOID;	// State of its vehicle
+static vehicle_queue_t my_queue;		// Vehicles waiting on my road
+static vehicle_queue_t its_queue;		// Vehicles waiting on its road
+static vehicle_count_t my_count;		// Last cumulative count reported by my G
+static phase_timing_t my_timing;		// Arrival rate and wait statistics of my road
+static phase_timing_t its_timing;		// Arrival rate of its road (only the queue is known)
+static bool its_updated = false;		// Did other tl send its queue since the last red?
+static movement_set_t my_movement;		// Movimento servito da questo semaforo (arbiter.h)
+static movement_set_t its_movement;		// Movimento servito dall'altro semaforo
+static latency_pending_t my_pending;	// Press and receive times of the vehicles on my road
+static clock_time_t decision;			// When MANAGE_TRAFFIC gave the green to my road
+static bool preempt = false;			// Emergency without emergencies on the other road: cut the phase now
+static bool wait_red = false;			// Preempting for my road: no green until the other tl confirms its red
+static bool wait_sent = false;			// The DEMAND that starts the wait has been sent
+static uint8_t wait_seqno;				// Its seqno: only a confirmation of it or of a later DEMAND counts
+static bool confirm_red = false;		// Red for an emergency on its road: my DEMANDs confirm it
+static uint8_t its_demand;				// Last DEMAND with emergencies received from the other tl
+static clock_time_t emergency_press;	// Press time of the first emergency waiting on my road
+static bool demand_lost = false;		// My queue did not reach the other tl: send it again
+static uint8_t demand_retries = 0;		// DEMAND repeated since the last one that got through
+
+// Latenze dei veicoli della propria strada (comando seriale LAT)
+static latency_hist_t lat_recv = {"pressione-ricezione"};
+static latency_hist_t lat_wait = {"ricezione-decisione"};
+static latency_hist_t lat_green = {"decisione-verde"};
+static latency_hist_t lat_total = {"pressione-verde"};
+static latency_hist_t lat_preempt = {"emergenza pressione-verde"};
+
+// La mia coda all'altro semaforo, una sola DEMAND in coda (la più aggiornata); con un'emergenza
+// o la conferma del rosso usa la classe più urgente. La conferma indica la DEMAND a cui risponde,
+// così una conferma partita prima dell'emergenza non sblocca il verde
+static void send_demand(void){
+
+	its_msg_demand_t demand;
+	const linkaddr_t *to = linkaddr_cmp(&linkaddr_node_addr, &tl1_addr) ? &tl2_addr : &tl1_addr;
+
+	its_msg_init(&demand.hdr, ITS_MSG_DEMAND);
+	demand.normal = my_queue.normal;
+	demand.emergency = my_queue.emergency;
+	demand.red = confirm_red;
+	demand.confirm = its_demand;
+	if(wait_red && !wait_sent){
+		wait_seqno = demand.hdr.seqno;
+		wait_sent = true;
+	}
+	tx_queue_cancel(ITS_MSG_DEMAND, to);
+	tx_queue_push(demand.emergency != 0 || demand.red ? TX_QUEUE_EMERGENCY : TX_QUEUE_CONTROL, to, &demand, sizeof(demand));
 
-static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8_t seqno){
+}
+
+// Code delle due strade tradotte in movimenti: il verde va a chi viene servito dall'arbitro
+static bool arbitrate(void){
+
+	movement_set_t normal = 0, emergency = 0;
+
+	if(my_queue.emergency != 0)
+		emergency |= my_movement;
+	else if(my_queue.normal != 0)
+		normal |= my_movement;
+
+	if(its_queue.emergency != 0)
+		emergency |= its_movement;
+	else if(its_queue.normal != 0)
+		normal |= its_movement;
 
-	#ifdef DEBUG
-		printf("DEBUG: runicast message received from %d.%d, seqno %d, msg: %s\n", from->u8[0], from->u8[1], seqno, (char *)packetbuf_dataptr());
-	#endif
-	if(linkaddr_cmp(from, &tl1_addr) || linkaddr_cmp(from, &tl2_addr)){	// Ho ricevuto il veicolo da TL*
+	return (arbiter_decide(normal, emergency) & my_movement) != 0;
 
-		its_vehicle = atoi((char *) packetbuf_dataptr());
+}
+
+static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8_t seqno){
+
+	const its_msg_notify_t *msg = its_msg_get(ITS_MSG_VEHICLE, sizeof(*msg));
+	const its_msg_demand_t *demand = its_msg_get(ITS_MSG_DEMAND, sizeof(*demand));
+	const its_msg_upgrade_t *upgrade = its_msg_get(ITS_MSG_UPGRADE, sizeof(*upgrade));
+	uint8_t arrivals, emergencies = my_queue.emergency;
+
+	ITS_LOG_DBG(RADIO, RUNICAST_RECV, from->u8[0], seqno, its_msg_type());
+	link_stats_rx(from);
+	// Ritrasmissione di un pacchetto già elaborato (ack perso)
+	if(dup_filter_check(from, seqno)){
+		ITS_LOG_DBG(RADIO, RUNICAST_DUP, from->u8[0], seqno, dup_filter_dropped());
+		return;
+	}
 
-		if(my_vehicle == NONE && its_vehicle == NONE)
+	if(demand != NULL){	// Ho ricevuto la coda da TL*
+
+		its_queue.normal = demand->normal;
+		its_queue.emergency = demand->emergency;
+		its_updated = true;
+		if(demand->emergency != 0)
+			its_demand = demand->hdr.seqno;
+		// L'altro semaforo è al rosso per una DEMAND con la mia emergenza: posso dare il verde
+		if(demand->red && wait_sent && (int8_t)(demand->confirm - wait_seqno) >= 0)
+			wait_red = false;
+		// L'altro semaforo ha un'emergenza e io no: la mia fase viene interrotta subito
+		if(demand->emergency != 0 && my_queue.emergency == 0)
+			preempt = true;
+
+		if(vehicle_queue_empty(&my_queue) && vehicle_queue_empty(&its_queue))
 			return;
 
 		if(tl_notified == true)
@@ -72,28 +177,57 @@ static void recv_runicast(struct runicast_conn *c, const linkaddr_t *from, uint8
 		else
 			state = SEND_NOTIFY_TL;
 
-	}else{	// Altrimenti giunge dallo SkyMote G*
+	}else if(msg != NULL || upgrade != NULL){	// Altrimenti giunge un veicolo dallo SkyMote G*, o il suo upgrade
 
-		my_vehicle = atoi((char *) packetbuf_dataptr());
-		state = SEND_NOTIFY_TL;
+		// I conteggi cumulativi del G* recuperano anche i veicoli dei report persi
+		if(msg != NULL)
+			arrivals = vehicle_queue_reconcile(&my_queue, &my_count, msg->count.normal, msg->count.emergency, msg->count.boot, msg->vehicle);
+		else
+			arrivals = vehicle_queue_reconcile(&my_queue, &my_count, upgrade->count.normal, upgrade->count.emergency, upgrade->count.boot, EMERGENCY);
+		if(arrivals > 0 && msg != NULL){	// Latenze solo per il veicolo del report: dei recuperati non si conosce la pressione
+			latency_add(&lat_recv, msg->age);
+			latency_pending_push(&my_pending, clock_time() - msg->age, clock_time());
+		}
+		while(arrivals-- > 0)
+			phase_timing_arrival(&my_timing);
+
+		// Prima emergenza in coda sulla mia strada: senza emergenze sull'altra la fase in corso viene
+		// interrotta, ma il verde attende la conferma del rosso dall'altro semaforo. L'upgrade di un
+		// veicolo già passato non cambia la coda e non interrompe la fase
+		if(emergencies == 0 && my_queue.emergency != 0){
+			emergency_press = clock_time() - (msg != NULL ? msg->age : upgrade->age);
+			if(its_queue.emergency == 0){
+				preempt = true;
+				wait_red = true;
+				wait_sent = false;
+			}
+		}
+		state = SEND_NOTIFY_TL;		// L'arbitraggio va rifatto con l'altro semaforo
 		tl_notified = false;
 
-	}
+	}else
+		return;
 
-	process_post(&tl, PROCESS_EVENT_MSG, NULL);
+	process_post(&tl_traffic, PROCESS_EVENT_MSG, NULL);
 
 }
 
 static void sent_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	#ifdef DEBUG
-		printf("DEBUG: runicast message sent to %d.%d, retransmissions %d\n", to->u8[0], to->u8[1], retransmissions);
-	#endif
+	ITS_LOG_DBG(RADIO, RUNICAST_SENT, to->u8[0], retransmissions);
+	tx_queue_done(to, retransmissions, 1);
+	if(linkaddr_cmp(to, &tl1_addr) || linkaddr_cmp(to, &tl2_addr))
+		demand_retries = 0;
 }
 
 static void timedout_runicast(struct runicast_conn *c, const linkaddr_t *to, uint8_t retransmissions){
-	printf("//// Timeout\n");
-	state = RESTORE_TL;
-	process_post(&tl, PROCESS_EVENT_MSG, NULL);
+	ITS_LOG_ERR(RADIO, RUNICAST_TIMEOUT, to->u8[0]);
+	tx_queue_done(to, retransmissions, 0);
+	// Le code restano: i veicoli sono già stati contati dai G* e non verrebbero più notificati.
+	// Una DEMAND persa viene ripetuta (al più DEMAND_RETRIES volte), un verde perso verso il G* tocca solo le sue latenze
+	if(linkaddr_cmp(to, &tl1_addr) || linkaddr_cmp(to, &tl2_addr)){
+		demand_lost = true;
+		process_post(&tl_traffic, PROCESS_EVENT_MSG, NULL);
+	}
 }
 
 static const struct runicast_callbacks runicast_calls = {recv_runicast, sent_runicast, timedout_runicast};
@@ -101,147 +235,106 @@ static const struct runicast_callbacks runicast_calls = {recv_runicast, sent_run
 static void broadcast_recv(struct broadcast_conn *c, const linkaddr_t *from){}
 
 static void broadcast_sent(struct broadcast_conn *c, int status, int num_tx){
-	#ifdef DEBUG
-		printf("DEBUG: broadcast message sent to sink\n");
-	#endif
+	ITS_LOG_DBG(RADIO, BROADCAST_SENT, status, num_tx);
 }
 
 static const struct broadcast_callbacks broadcast_call = {broadcast_recv, broadcast_sent}; 
 static struct broadcast_conn broadcast;
 
-PROCESS_THREAD(tl, ev, data){
+PROCESS_THREAD(tl_traffic, ev, data){
 
-	static struct etimer et, sensing_timer;
+	static struct etimer et;
+	static struct etimer resend;		// Ripetizione di una DEMAND persa
 
 	PROCESS_EXITHANDLER(runicast_close(&runicast));
-	PROCESS_EXITHANDLER(broadcast_close(&broadcast));
 
 	PROCESS_BEGIN();
 
-	static size_t battery_level = 100;			// Default battery level of tf
-	static size_t counter_until_20 = 0;			// Counter variable for tf, when timeout's sensing_timer is 1 second
 	static bool red_tl_enable = false;			// Wheter tf is red
-	static bool timer10_flag = false;			// When timeout's sensing_timer is 10 second
-	static bool timer20_flag = false;			// When timeout's sensing_timer is 20 second
-	static bool button_activated = false;		// Variable state of button when battery level is below to 20
-	static bool et_expired = false;				// Il blink_timer (et) o sensing_timer sono scaduti, quindi è possibile per fare alcuni controlli
-	static char message[2];
-	static int temperature = 0, humidity = 0;
-	static measurement_t sensing;				// Where to store sensing values
+	static uint8_t i;
+	static its_msg_vehicle_t message;
 	static linkaddr_t recv;
 
+	its_log_init();
 	runicast_open(&runicast, 144, &runicast_calls);
-	broadcast_open(&broadcast, 150, &broadcast_call);
+	tx_queue_open(&runicast);
+	phase_timing_init(&my_timing);
+	phase_timing_init(&its_timing);
+
+	// Movimenti nel piano dell'incrocio: TL1 sull'approccio 0, TL2 sull'approccio 1
+	if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){
+		my_movement = ARBITER_MOVE(0, ARBITER_STRAIGHT);
+		its_movement = ARBITER_MOVE(1, ARBITER_STRAIGHT);
+	} else {
+		my_movement = ARBITER_MOVE(1, ARBITER_STRAIGHT);
+		its_movement = ARBITER_MOVE(0, ARBITER_STRAIGHT);
+	}
+
 	leds_on(LEDS_GREEN);
 	leds_off(LEDS_RED);
 	etimer_set(&et, CLOCK_SECOND);
-	etimer_set(&sensing_timer, CLOCK_SECOND * 5);
 
 	while(1){
 
-		PROCESS_WAIT_EVENT();
+		// EVENTI:
+		//	- et scaduto (blink, fine del rosso/verde)
+		//	- veicolo ricevuto da G* o coda ricevuta dall'altro TL*
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || ev == PROCESS_EVENT_MSG);
 
-		if(et_expired == true && button_activated == false){
+		// Preemption: la fase in corso termina ora e la DEMAND parte con la classe più urgente. Chi ha
+		// l'emergenza dà il verde solo quando l'altro semaforo conferma il rosso (DEMAND con red),
+		// così i due semafori non sono mai verdi insieme
+		if(preempt){
 
-			if(battery_level < 20){
-				SENSORS_ACTIVATE(button_sensor);
-				button_activated = true;
-			}
-			if(timer10_flag == false && battery_level <= 50){
-				etimer_set(&sensing_timer, CLOCK_SECOND * 10);
-				timer10_flag = true;
-			}else if(timer20_flag == false && battery_level <= 20){
-				etimer_set(&sensing_timer, CLOCK_SECOND);
-				timer20_flag = true;
-			}
-			et_expired = false;
+			ITS_LOG_INFO(TRAFFIC, PREEMPT, my_queue.emergency, its_queue.emergency);
 
-		}
+			preempt = false;
+			red_tl_enable = false;
 
-		if(button_activated == true && ev == sensors_event && data == &button_sensor){
+		}
 
-			battery_level = 100;
-			counter_until_20 = 0;
-			timer10_flag = false;
-			timer20_flag = false;
-			button_activated = false;
-			SENSORS_DEACTIVATE(button_sensor);
-			leds_off(LEDS_BLUE);
-			etimer_set(&sensing_timer, CLOCK_SECOND * 5);
-			continue;
+		// DEMAND persa: l'altro semaforo può essere fermo ad attendere la mia coda, gliela ripeto dopo
+		// un'attesa crescente. Dopo DEMAND_RETRIES tentativi l'altro semaforo è considerato spento e
+		// si torna al lampeggio, come prima delle ripetizioni
+		if(demand_lost){
+
+			demand_lost = false;
+			if(demand_retries < DEMAND_RETRIES)
+				etimer_set(&resend, DEMAND_BACKOFF << demand_retries++);
+			else{
+				demand_retries = 0;
+				etimer_stop(&resend);
+				state = RESTORE_TL;
+			}
 
 		}
 
+		if(ev == PROCESS_EVENT_TIMER && data == &resend)
+			send_demand();
+
 		if(state == BLINK && etimer_expired(&et)){
 
-			printf("STATO: BLINK\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_BLINK);
 
+			energy_acct_enter(ENERGY_BLINK);
 			leds_toggle(LEDS_GREEN);
 			leds_toggle(LEDS_RED);
-			battery_level = (int)(battery_level - 5) > 0 ? (battery_level - 5) : 0;
-			et_expired = true;
 			etimer_reset(&et);
 
 		}
 
-		// Se la batteria va a 0, non faccio più sensing
-		if(etimer_expired(&sensing_timer)){
-
-			etimer_reset(&sensing_timer);
-			if(button_activated == true){
-				counter_until_20++;
-				leds_toggle(LEDS_BLUE);
-				if(counter_until_20 < 20 || battery_level <= 0)
-					continue;
-				else
-					counter_until_20 = 0;
-			}
-
-			SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
-			et_expired = true;
-			battery_level = (int)(battery_level - 10) > 0 ? (battery_level - 10) : 0;
-			
-			sensing.type = 'T';
-			sensing.value = (sht11_sensor.value(SHT11_SENSOR_TEMP)/10 - 396)/10;
-			temperature = sensing.value;
-			packetbuf_copyfrom(&sensing, sizeof(sensing));
-			broadcast_send(&broadcast);
-			
-			sensing.type = 'H';
-			humidity = sht11_sensor.value(SHT11_SENSOR_HUMIDITY);
-			// Fix umidità
-			sensing.value = -4 + 0.0405 * humidity + (-2.8 * 0.000001) * (humidity * humidity);
-			sensing.value = (temperature - 25) * (0.01 + 0.00008 * humidity) + sensing.value;
-			packetbuf_copyfrom(&sensing, sizeof(sensing));
-			broadcast_send(&broadcast);
-
-			SENSORS_DEACTIVATE(sht11_sensor);
-			continue;
-
-		}
-
 		if(tl_notified == false && ((state == SEND_NOTIFY_TL && red_tl_enable == false) 
 			|| (state == SEND_NOTIFY_TL && red_tl_enable == true && etimer_expired(&et)))){ // Comunica l'informazione all'altro semaforo, così si gestiranno le priorità
 
-			printf("STATO: SEND_NOTIFY_TL\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_SEND_NOTIFY_TL);
 
+			energy_acct_enter(ENERGY_TRAFFIC);
 			red_tl_enable = false;
 
-			if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){
-				recv.u8[0] = TL2_ADDR;
-				recv.u8[1] = 0;
-			}else{
-				recv.u8[0] = TL1_ADDR;
-				recv.u8[1] = 0;
-			}
-
-			sprintf(message, "%d", my_vehicle);
-			if(!runicast_is_transmitting(&runicast)) {
-				packetbuf_copyfrom(message, 2);
-				runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
-			}
+			etimer_stop(&resend);		// Questa DEMAND sostituisce la ripetizione in attesa
+			send_demand();
 
-			if(its_vehicle != VOID)		// Nel caso abbia ricevuto la macchina vuol dire che è già stato contattato
+			if(its_updated)		// Nel caso abbia ricevuto la macchina vuol dire che è già stato contattato
 				state = MANAGE_TRAFFIC;	// Scambio auto avvenuto, ora entrambi i sensori vedono gli stessi dati
 
 			tl_notified = true;
@@ -250,64 +343,55 @@ PROCESS_THREAD(tl, ev, data){
 
 		if((state == MANAGE_TRAFFIC && red_tl_enable == false) || (state == MANAGE_TRAFFIC && red_tl_enable == true && etimer_expired(&et))){
 
-			printf("STATO: MANAGE_TRAFFIC\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_MANAGE_TRAFFIC);
 
+			energy_acct_enter(ENERGY_TRAFFIC);
 			red_tl_enable = true;
 			tl_notified = false;
-			if(its_vehicle == VOID)	// FIX: Può capitare di saltare in questo stato da RED_TL
-				its_vehicle = NONE;
-
-			// ho la priorità se ho una qualunque auto e:
-			// - lui non ha macchine
-			// - lui ha auto normali
-			// - ho un auto di emergenza e lui anche
-			if(my_vehicle != NONE){
-
-				if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){ 		// Prioritario
-					if(its_vehicle != EMERGENCY || (my_vehicle == EMERGENCY && its_vehicle == EMERGENCY))
-						state = SEND_NOTIFY_CAR;
-					else
-						state = RED_TL;
-					
-				}
+			its_updated = true;		// FIX: Può capitare di saltare in questo stato da RED_TL (coda dell'altro già svuotata)
 
-				// ho la priorità se ho una qualunque auto e:
-				// - lui non ha macchine
-				// - ho un auto di emergenza e lui no
-				if(linkaddr_cmp(&linkaddr_node_addr, &tl2_addr)){ 		// NON prioritario
-					if(its_vehicle == NONE || (my_vehicle == EMERGENCY && its_vehicle != EMERGENCY))
-						state = SEND_NOTIFY_CAR;
-					else
-						state = RED_TL;
+			// Emergenza prima di tutto; a parità di veicolo vince la fase che viene prima nel piano (TL1)
+			if(!vehicle_queue_empty(&my_queue) && arbitrate()){
+				if(wait_red){		// Preemption: senza la conferma del rosso si resta qui, fuori dal timer della fase
+					red_tl_enable = false;
+					continue;
 				}
-
-			} else {
-
+				decision = clock_time();
+				state = SEND_NOTIFY_CAR;
+			} else
 				state = RED_TL;
 
-			}
-
 		}
 
 		if(state == RED_TL){
 
-			printf("STATO: RED_TL\n");
-
-			its_vehicle = VOID;
-			if(my_vehicle == NONE)
+			ITS_LOG_INFO(TRAFFIC, STATE_RED_TL);
+
+			energy_acct_enter(ENERGY_TRAFFIC);
+			wait_red = false;
+			// Emergenza sull'altra strada: le confermo il rosso, il suo verde attende questa DEMAND
+			confirm_red = its_queue.emergency != 0;
+			if(confirm_red)
+				send_demand();
+			etimer_set(&et, phase_timing_green(&its_timing, &its_queue));	// Il rosso dura quanto il verde dell'altra strada
+			vehicle_queue_clear(&its_queue);		// L'altra strada è al verde e scarica la sua coda
+			phase_timing_discard(&its_timing);
+			its_updated = false;
+			if(vehicle_queue_empty(&my_queue))
 				state = RESTORE_TL;
 			else
 				state = MANAGE_TRAFFIC;
 			leds_on(LEDS_RED);
 			leds_off(LEDS_GREEN);
-			etimer_set(&et, CLOCK_SECOND * 5);
 			continue;
 		}
 
 		if(state == SEND_NOTIFY_CAR){ // Dico sì alla macchinuccia
 
-			printf("STATO: SEND_NOTIFY_CAR\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_SEND_NOTIFY_CAR);
 
+			energy_acct_enter(ENERGY_TRAFFIC);
+			confirm_red = false;
 			if(linkaddr_cmp(&linkaddr_node_addr, &tl1_addr)){
 				recv.u8[0] = G1_ADDR;
 				recv.u8[1] = 0;
@@ -316,39 +400,55 @@ PROCESS_THREAD(tl, ev, data){
 				recv.u8[1] = 0;
 			}
 
-			sprintf(message, "%d", my_vehicle);
-			if(!runicast_is_transmitting(&runicast)) {
-				packetbuf_copyfrom(message, 2);
-				runicast_send(&runicast, &recv, MAX_RETRANSMISSIONS);
-			}
+			its_msg_init(&message.hdr, ITS_MSG_GREEN);
+			message.vehicle = vehicle_queue_top(&my_queue);
+			message.age = clock_time() - decision;
+			tx_queue_push(message.vehicle == EMERGENCY ? TX_QUEUE_EMERGENCY : TX_QUEUE_NOTIFY, &recv, &message, sizeof(message));
 			state = GREEN_TL;
 
 		}
 
 		if(state == GREEN_TL){
 
-			printf("STATO: GREEN_TL\n");
-
-			my_vehicle = NONE;			
+			ITS_LOG_INFO(TRAFFIC, STATE_GREEN_TL, vehicle_queue_length(&my_queue));
+
+			energy_acct_enter(ENERGY_GREEN);
+			etimer_set(&et, phase_timing_green(&my_timing, &my_queue));	// Il verde termina quando la coda è smaltita
+			if(my_queue.emergency != 0)		// Prima di svuotare la coda
+				latency_add(&lat_preempt, clock_time() - emergency_press);
+			phase_timing_served(&my_timing, &my_queue);
+			vehicle_queue_clear(&my_queue);		// Un solo verde serve tutti i veicoli in coda
+			for(i = 0; i < my_pending.count; i++){
+				latency_add(&lat_wait, decision - my_pending.recv[i]);
+				latency_add(&lat_total, clock_time() - my_pending.press[i]);
+			}
+			latency_add(&lat_green, clock_time() - decision);
+			latency_pending_clear(&my_pending);
+			ITS_LOG_INFO(TRAFFIC, TRAFFIC_STATS, my_timing.served, phase_timing_avg_wait(&my_timing), phase_timing_rate(&my_timing));
 			leds_on(LEDS_GREEN);
 			leds_off(LEDS_RED);
-			if(its_vehicle == NONE)
+			if(vehicle_queue_empty(&its_queue))
 				state = RESTORE_TL;
 			else
 				state = MANAGE_TRAFFIC;
-			etimer_set(&et, CLOCK_SECOND * 5);
 			continue;
 		}
 
 		if(state == RESTORE_TL && etimer_expired(&et)){
 
-			printf("RESTORE_TL\n");
+			ITS_LOG_INFO(TRAFFIC, STATE_RESTORE_TL);
 
 			state = BLINK;
 			red_tl_enable = false;
 			tl_notified = false;
-			my_vehicle = NONE;
-			its_vehicle = VOID;
+			wait_red = false;
+			confirm_red = false;
+			vehicle_queue_clear(&my_queue);
+			vehicle_queue_clear(&its_queue);
+			phase_timing_discard(&my_timing);
+			phase_timing_discard(&its_timing);
+			latency_pending_clear(&my_pending);
+			its_updated = false;
 			leds_toggle(LEDS_GREEN);
 			leds_toggle(LEDS_RED);
 			etimer_set(&et, CLOCK_SECOND * 1);
@@ -359,4 +459,162 @@ PROCESS_THREAD(tl, ev, data){
 
 	PROCESS_END();
 
-}
\ No newline at end of file
+}
+
+PROCESS_THREAD(tl_sensing, ev, data){
+
+	static struct etimer sensing_timer;			// Timer per fare sensing con la cadenza corrente
+
+	PROCESS_EXITHANDLER(broadcast_close(&broadcast));
+
+	PROCESS_BEGIN();
+
+	static sensing_input_t input;				// Stato del nodo passato alla politica di campionamento
+	static sensing_stats_t stats;				// Media e varianza recenti della temperatura
+	static clock_time_t interval;				// Intervallo scelto dalla politica, 0 se il sensing è sospeso
+	static sample_t sensing;					// Ultima misura di temperatura e umidità
+	static sample_batch_t batch;				// Misure in attesa di invio a G1
+	static its_msg_batch_t upload;				// Frame del batch
+	static deadband_t deadband;					// Ultima misura inviata a G1
+	static uint8_t previous;					// Stato energetico interrotto dal sensing
+
+	broadcast_open(&broadcast, 150, &broadcast_call);
+
+	interval = SENSING_POLICY_MIN;
+	etimer_set(&sensing_timer, interval);
+	printf("SENSING: politica %s\n", SENSING_POLICY.name);
+
+	while(1){
+
+		// EVENTI:
+		//	- sensing_timer scaduto
+		//	- poll da tl_energy quando la batteria viene sostituita
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || ev == PROCESS_EVENT_POLL);
+
+		if(ev == PROCESS_EVENT_TIMER && interval != 0){
+
+			previous = energy_acct_enter(ENERGY_SENSING);
+			SENSORS_ACTIVATE(sht11_sensor);	// Burst sensor time
+
+			// Temperatura e umidità viaggiano nello stesso batch
+			sensing.temperature = sht11_conv_temperature(sht11_sensor.value(SHT11_SENSOR_TEMP));
+			sensing.humidity = sht11_conv_humidity(sht11_sensor.value(SHT11_SENSOR_HUMIDITY), sensing.temperature);
+			SENSORS_DEACTIVATE(sht11_sensor);
+
+			// La misura entra nel batch solo se è cambiata o per heartbeat; G1 tiene valida l'ultima ricevuta
+			if(deadband_changed(&deadband, sensing.temperature, sensing.humidity)){
+				sample_batch_add(&batch, sensing.temperature, sensing.humidity);
+				deadband_sent(&deadband, sensing.temperature, sensing.humidity);
+			}
+
+			// Buffer pieno o misura più vecchia in scadenza: un solo frame per tutte le misure accumulate
+			if(sample_batch_due(&batch)){
+				packetbuf_copyfrom(&upload, sample_batch_encode(&batch, &upload));
+				broadcast_send(&broadcast);
+			}
+			energy_acct_enter(previous);
+			sensing_stats_add(&stats, sensing.temperature);
+
+		}
+
+		// La politica sceglie il prossimo intervallo; con il sensing sospeso si ricontrolla dopo SENSING_POLICY_MAX
+		input.level = energy_acct_level();
+		input.variance = stats.variance;
+		input.activity = phase_timing_activity(&my_timing);
+		interval = SENSING_POLICY.next_interval(&input);
+		etimer_set(&sensing_timer, interval != 0 ? interval : SENSING_POLICY_MAX);
+
+	}
+
+	PROCESS_END();
+
+}
+
+PROCESS_THREAD(tl_energy, ev, data){
+
+	static struct etimer energy_timer;			// Aggiornamento periodico della contabilità energetica
+
+	PROCESS_EXITHANDLER(broadcast_close(&energy_broadcast));
+
+	PROCESS_BEGIN();
+
+	static bool button_activated = false;		// Flag attivo quando la carica è < 20 %: il pulsante segnala la batteria sostituita
+	static uint8_t level = 100;					// Carica residua stimata, %
+	static uint8_t updates = 0;					// Aggiornamenti dall'ultimo report
+	static its_msg_energy_t report;				// Report dei consumi per stato verso G1
+
+	energy_acct_init();
+	broadcast_open(&energy_broadcast, ITS_MSG_ENERGY_CHANNEL, &energy_call);
+	etimer_set(&energy_timer, CLOCK_SECOND * ENERGY_PERIOD);
+
+	while(1){
+
+		// EVENTI:
+		//	- energy_timer scaduto
+		//	- bottone (solo con batteria scarica)
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || (ev == sensors_event && data == &button_sensor));
+
+		// Quando il pulsante è stato attivato, e viene premuto ripristina lo stato di sensing del mote
+		if(ev == sensors_event){
+
+			if(button_activated == false)
+				continue;
+			energy_acct_recharge();
+			button_activated = false;
+			SENSORS_DEACTIVATE(button_sensor);
+			leds_off(LEDS_BLUE);
+			process_poll(&tl_sensing);	// Riprende subito il sensing se era sospeso
+
+		} else {
+
+			etimer_reset(&energy_timer);
+			energy_acct_update();
+
+			if(++updates == ENERGY_REPORT_EVERY){
+				updates = 0;
+				energy_acct_report(&report, ENERGY_PERIOD * ENERGY_REPORT_EVERY);
+				packetbuf_copyfrom(&report, sizeof(report));
+				broadcast_send(&energy_broadcast);
+			}
+
+		}
+
+		level = energy_acct_level();
+		if(level < 20 && button_activated == false){
+			SENSORS_ACTIVATE(button_sensor);
+			leds_on(LEDS_BLUE);		// Batteria scarica: blu acceso fino alla sostituzione
+			button_activated = true;
+		}
+
+	}
+
+	PROCESS_END();
+
+}
+
+PROCESS_THREAD(tl_serial, ev, data){
+
+	PROCESS_BEGIN();
+
+	while(1){
+
+		// EVENTI:
+		//	- comando da seriale
+		PROCESS_WAIT_EVENT_UNTIL(ev == serial_line_event_message);
+
+		if(!strcmp((char *) data, "LAT")){
+			latency_print(&lat_recv);
+			latency_print(&lat_wait);
+			latency_print(&lat_green);
+			latency_print(&lat_total);
+			latency_print(&lat_preempt);
+			printf("DUP: scartati %u\n", dup_filter_dropped());
+		}
+		if(!strcmp((char *) data, "LINKS"))
+			link_stats_print();
+
+	}
+
+	PROCESS_END();
+
+}
@@ -0,0 +1,40 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+// I semafori ricevono le notifiche dei veicoli: la frequenza di controllo del
+// canale limita la latenza veicolo-verde (al più 1/16 s per frame) e la coda
+// tiene traffico, sensing e report di energia in trasmissione insieme.
+// Sovrascrivibile da bench/run.sh (BENCH_CHECK_RATE_<ruolo>) per confrontare le frequenze
+#ifdef ITS_CONF_CHECK_RATE
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	ITS_CONF_CHECK_RATE
+#else
+	#define NETSTACK_CONF_RDC_CHANNEL_CHECK_RATE	16
+#endif
+#define QUEUEBUF_CONF_NUM			8
+
+#if CONTIKI_TARGET_NATIVE
+	// Radio simulata su UDP loopback (sim/sim-radio.c): sempre accesa, senza duty cycling
+	#define NETSTACK_CONF_RADIO		sim_radio_driver
+	#define NETSTACK_CONF_RDC			nullrdc_driver
+#else
+	// Duty cycling della radio: la radio resta spenta tra due controlli del canale
+	#define NETSTACK_CONF_MAC			csma_driver
+	#define NETSTACK_CONF_RDC			contikimac_driver
+	#define CONTIKIMAC_CONF_WITH_PHASE_OPTIMIZATION	1	// Runicast: trasmette solo attorno al risveglio noto del vicino
+	// Seriale a interrupt: il drain del log (common/its-log.c) non attende la UART byte per byte
+	#define UART1_CONF_TX_WITH_INTERRUPT	1
+#endif
+
+// Solo Rime e messaggi ITS di poche decine di byte: buffer ridotti per liberare RAM
+#define PACKETBUF_CONF_SIZE			64
+
+// Misure inviate a G1 solo su variazione o come heartbeat (common/deadband.h)
+#define DEADBAND_CONF_ON			1
+
+// Contabilità energetica per stato (common/energy-acct.c)
+#define ENERGEST_CONF_ON			1
+
+// Politica di campionamento (common/sensing-policy.h): sensing_policy_threshold o sensing_policy_proportional
+//#define SENSING_POLICY_CONF		sensing_policy_proportional
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,154 @@
+#!/bin/bash
+#
+# Benchmark Broadcast contro Unicast: stesso incrocio (G1, G2, TL1, TL2), stessi
+# arrivi dei veicoli e stesso sensing per entrambi gli alberi, poi una tabella
+# con frame trasmessi, ritrasmissioni runicast, radio accesa e latenza
+# pulsante-verde (percentili).
+#
+# Uso: ./run.sh <cooja|native> [durata_s]
+#
+#  cooja	compila per Sky con DEFINES=COOJA e lancia Cooja senza GUI su
+#			broadcast.csc e unicast.csc (carico in workload.js); la radio accesa
+#			è quella di ContikiMAC misurata da energest
+#  native	compila per native e avvia i 4 nodi su radio UDP (sim/) con seme
+#			fisso; senza duty cycling la radio risulta sempre accesa
+#
+# Variabili d'ambiente:
+#  CONTIKI				sorgenti di Contiki (default /home/user/contiki)
+#  BENCH_SEED			seme degli arrivi in native (default 1; Cooja usa quello di workload.js)
+#  ITS_SIM_ARRIVAL_MS	tempo medio tra due veicoli per ogni G* in native (default 8000)
+#  ITS_SIM_EMERGENCY	percentuale di emergenze in native (default 10)
+#  ITS_SIM_LOSS			percentuale di frame persi in native (default 0)
+#  BENCH_CHECK_RATE_G1, BENCH_CHECK_RATE_G2, BENCH_CHECK_RATE_TL
+#						controlli del canale al secondo di ContikiMAC per ruolo in
+#						cooja (default quelli di project-conf.h: 16, 8, 16)
+#
+# Ogni esecuzione lascia in out/<albero>/events.log le righe "<ms> <nodo> <testo>"
+# usate per i conteggi.
+
+MODE=${1:?Uso: $0 <cooja|native> [durata_s]}
+DURATION=${2:-600}
+BENCH_DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$BENCH_DIR/.." && pwd)
+OUT=$BENCH_DIR/out
+CONTIKI=${CONTIKI:-/home/user/contiki}
+TREES="Broadcast Unicast"
+
+run_cooja(){
+
+	local tree=$1 role rate defines
+
+	for role in G1 G2 TL; do
+		rate=BENCH_CHECK_RATE_$role
+		defines=COOJA${!rate:+,ITS_CONF_CHECK_RATE=${!rate}}
+		# Gli oggetti compilati senza COOJA hanno gli indirizzi dei mote reali
+		make -C "$ROOT/$tree/$role" TARGET=sky CONTIKI="$CONTIKI" clean > /dev/null
+		make -C "$ROOT/$tree/$role" TARGET=sky CONTIKI="$CONTIKI" DEFINES=$defines $role.sky > /dev/null || exit 1
+	done
+
+	(cd "$OUT/$tree" && java -Dbench.duration="$DURATION" -mx512m -jar "$CONTIKI/tools/cooja/dist/cooja.jar" \
+		-nogui="$BENCH_DIR/$(echo "$tree" | tr A-Z a-z).csc" -contiki="$CONTIKI" > cooja.log 2>&1)
+	# I nodi Sky scrivono gli eventi come record binari del log (common/its-log.h)
+	grep -E '^[0-9]+ [0-9]+ ' "$OUT/$tree/COOJA.testlog" | "$ROOT/sim/log-decode.py" > "$OUT/$tree/events.log"
+
+}
+
+# Avvia un nodo native: <albero> <ruolo> <indirizzo> <nome>; ogni riga riceve i ms dall'avvio del benchmark
+start_node(){
+	sleep $((DURATION + 5)) | ITS_NODE=$3 ITS_SIM_ARRIVAL_MS=$ARRIVAL "$ROOT/$1/$2/$2.native" 2>&1 |
+		perl -MTime::HiRes=time -ne 'BEGIN { $| = 1 } printf "%d %d %s", time * 1000 - $ENV{T0}, '$3', $_' > "$OUT/$1/$4.log" &
+}
+
+run_native(){
+
+	local tree=$1 role
+
+	for role in G1 G2 TL; do
+		make -C "$ROOT/$tree/$role" -j5 TARGET=native CONTIKI="$CONTIKI" > /dev/null || exit 1
+	done
+
+	export ITS_SIM_SEED=${BENCH_SEED:-1} ITS_SIM_TRACE=1
+	export ITS_SIM_EMERGENCY=${ITS_SIM_EMERGENCY:-10} ITS_SIM_LOSS=${ITS_SIM_LOSS:-0}
+	export T0=$(date +%s%3N)
+
+	ARRIVAL=0
+	start_node "$tree" TL 3 TL1
+	start_node "$tree" TL 4 TL2
+	ARRIVAL=${ITS_SIM_ARRIVAL_MS:-8000}
+	start_node "$tree" G1 1 G1
+	start_node "$tree" G2 2 G2
+
+	sleep "$DURATION"
+	pkill -f "$ROOT/$tree/.*\.native"
+	wait 2> /dev/null
+
+	sort -n -k1,1 "$OUT/$tree"/*.log > "$OUT/$tree/events.log"
+
+}
+
+# Metriche di un albero da events.log, una "chiave valore" per riga
+analyze(){
+
+	local dir=$OUT/$1
+
+	awk -v lat="$dir/latency" '
+		$3 == "SIM:" && $4 == "tx"		{ frames++; next }
+		$3 == "SIM:" && $4 == "arrival"	{ arrivals++; pending[$2, ++queued[$2]] = $1; next }
+		/retransmissions/				{ sent++; retx += $NF; next }
+		/\/\/\/\/ Timeout/				{ timeouts++; next }
+		# Il verde di un TL serve tutta la coda del suo approccio: latenza di ogni veicolo in attesa sul G
+		$3 == "VERDE:" {
+			for(i = 1; i <= queued[$2]; i++){
+				print $1 - pending[$2, i] > lat
+				served++
+			}
+			queued[$2] = 0
+			next
+		}
+		# Righe ENERGY di G1: "<ms> 1 ENERGY: <nodo> LIVELLO <l>% RADIO <r>% ..."
+		$3 == "ENERGY:" && $2 == 1		{ radio += $8; reports++ }
+		END {
+			printf "arrivi %d\nserviti %d\nframe %d\nrunicast %d\nritrasmissioni %d\ntimeout %d\n", arrivals, served, frames, sent, retx, timeouts
+			printf "radio %.2f\n", reports ? radio / reports : 0
+		}' "$dir/events.log" > "$dir/metrics"
+
+	touch "$dir/latency"
+	sort -n "$dir/latency" | awk '
+		{ v[NR] = $1 }
+		function pct(q,  i){ i = int(q * NR + 0.999); return NR ? v[i < 1 ? 1 : i] / 1000 : 0 }
+		END { printf "p50 %.2f\np90 %.2f\np99 %.2f\nmax %.2f\n", pct(0.5), pct(0.9), pct(0.99), pct(1) }' >> "$dir/metrics"
+
+}
+
+metric(){
+	awk -v k="$2" '$1 == k { print $2 }' "$OUT/$1/metrics"
+}
+
+case "$MODE" in
+	cooja|native) ;;
+	*) echo "Modo sconosciuto: $MODE (cooja o native)"; exit 1 ;;
+esac
+
+rm -rf "$OUT"
+for tree in $TREES; do
+	mkdir -p "$OUT/$tree"
+	echo "$tree: $MODE per ${DURATION}s..."
+	run_$MODE "$tree"
+	analyze "$tree"
+done
+
+printf "\n%-28s %12s %12s\n" "" $TREES
+row(){
+	printf "%-28s %12s %12s\n" "$1" "$(metric Broadcast "$2")" "$(metric Unicast "$2")"
+}
+row "Veicoli arrivati" arrivi
+row "Veicoli al verde" serviti
+row "Frame trasmessi" frame
+row "Invii runicast" runicast
+row "Ritrasmissioni runicast" ritrasmissioni
+row "Timeout runicast" timeout
+row "Radio accesa media (%)" radio
+row "Latenza p50 (s)" p50
+row "Latenza p90 (s)" p90
+row "Latenza p99 (s)" p99
+row "Latenza max (s)" max
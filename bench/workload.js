@@ -0,0 +1,79 @@
+/*
+ * Carico di lavoro del benchmark per Cooja (ScriptRunner), comune a
+ * broadcast.csc e unicast.csc.
+ *
+ * Preme i pulsanti di G1 (id 1) e G2 (id 2) con arrivi uniformi in
+ * [ARRIVAL_MS/2, 3*ARRIVAL_MS/2] da un generatore a seme fisso, quindi entrambi
+ * gli alberi vedono la stessa sequenza di veicoli; un'emergenza è una doppia
+ * pressione a 200 ms. Scrive nel log di test una riga "<ms> <id> <testo>" per
+ * ogni evento che bench/run.sh analizza:
+ *  - SIM: arrival <n> NORMAL|EMERGENCY	pressione del pulsante
+ *  - SIM: tx							frame trasmesso dalla radio del nodo
+ *  - righe dei nodi: VERDE, retransmissions, Timeout, ENERGY, TRAFFICO; sui
+ *    Sky gli eventi arrivano come record "@L" di common/its-log.h, decodificati
+ *    da bench/run.sh
+ *
+ * Durata in secondi simulati: proprietà Java bench.duration (default 600,
+ * al più un'ora per il TIMEOUT sotto).
+ */
+
+TIMEOUT(3600000);
+
+var SEED = 1;
+var ARRIVAL_MS = 8000;
+var EMERGENCY = 10;					// Percentuale di veicoli di emergenza
+var DOUBLE_PRESS_MS = 200;
+var DURATION_MS = java.lang.Integer.parseInt(java.lang.System.getProperty("bench.duration", "600")) * 1000;
+
+var rnd = [null, new java.util.Random(SEED * 31 + 1), new java.util.Random(SEED * 31 + 2)];
+var vehicles = [0, 0, 0];
+var relevant = /^(@L|VERDE:|DEBUG: runicast message sent|\/\/\/\/ Timeout|ENERGY:|TRAFFICO:)/;
+
+function now(){
+	return sim.getSimulationTimeMillis();
+}
+
+function press(id){
+	sim.getMoteWithID(id).getInterfaces().getButton().clickButton();
+}
+
+function schedule(id){
+	GENERATE_MSG(ARRIVAL_MS / 2 + rnd[id].nextInt(ARRIVAL_MS + 1), "arrival " + id);
+}
+
+// Frame trasmessi, contati sul mezzo radio: includono ripetizioni del MAC e ack
+sim.getRadioMedium().addRadioTransmissionObserver(new java.util.Observer({
+	update: function(obs, obj){
+		var conn = sim.getRadioMedium().getLastConnection();
+		if(conn != null)
+			log.log(now() + " " + conn.getSource().getMote().getID() + " SIM: tx\n");
+	}
+}));
+
+schedule(1);
+schedule(2);
+GENERATE_MSG(DURATION_MS, "end");
+
+while(true){
+
+	YIELD();
+
+	if(msg.equals("end")){
+		log.testOK();
+	} else if(msg.startsWith("arrival ")){
+		var g = parseInt(msg.substring(8));
+		vehicles[g]++;
+		press(g);
+		if(rnd[g].nextInt(100) < EMERGENCY){
+			GENERATE_MSG(DOUBLE_PRESS_MS, "second " + g);
+			log.log(now() + " " + g + " SIM: arrival " + vehicles[g] + " EMERGENCY\n");
+		} else
+			log.log(now() + " " + g + " SIM: arrival " + vehicles[g] + " NORMAL\n");
+		schedule(g);
+	} else if(msg.startsWith("second ")){
+		press(parseInt(msg.substring(7)));
+	} else if(relevant.test(msg)){
+		log.log(now() + " " + id + " " + msg + "\n");
+	}
+
+}
@@ -0,0 +1,100 @@
+#include "arbiter.h"
+
+#define M(approach, turn)	ARBITER_MOVE(approach, turn)
+#define S					ARBITER_STRAIGHT
+#define L					ARBITER_LEFT
+
+#define MOVEMENTS			16
+
+#if ARBITER_PLAN == ARBITER_PLAN_2WAY
+
+// TL1 (approccio 0) ha la precedenza su TL2 (approccio 1)
+static const movement_set_t phases[] = {
+	M(0, S),
+	M(1, S),
+};
+
+static const movement_set_t conflicts[MOVEMENTS] = {
+	[0 * 2 + S] = M(1, S),
+	[1 * 2 + S] = M(0, S),
+};
+
+#elif ARBITER_PLAN == ARBITER_PLAN_3WAY
+
+// 0 e 1 sono la strada principale (1 può svoltare a sinistra nella laterale), 2 la laterale
+static const movement_set_t phases[] = {
+	M(0, S) | M(1, S),
+	M(1, S) | M(1, L),
+	M(2, S) | M(2, L),
+};
+
+static const movement_set_t conflicts[MOVEMENTS] = {
+	[0 * 2 + S] = M(1, L) | M(2, L),
+	[1 * 2 + S] = M(2, S) | M(2, L),
+	[1 * 2 + L] = M(0, S) | M(2, S) | M(2, L),
+	[2 * 2 + S] = M(1, S) | M(1, L),
+	[2 * 2 + L] = M(0, S) | M(1, S) | M(1, L),
+};
+
+#elif ARBITER_PLAN == ARBITER_PLAN_4WAY
+
+// 0 e 2 sono opposti (nord, sud), 1 e 3 opposti (est, ovest)
+#define NS_STRAIGHT		(M(0, S) | M(2, S))
+#define NS_LEFT			(M(0, L) | M(2, L))
+#define EW_STRAIGHT		(M(1, S) | M(3, S))
+#define EW_LEFT			(M(1, L) | M(3, L))
+
+static const movement_set_t phases[] = {
+	NS_STRAIGHT,
+	NS_LEFT,
+	EW_STRAIGHT,
+	EW_LEFT,
+};
+
+static const movement_set_t conflicts[MOVEMENTS] = {
+	[0 * 2 + S] = EW_STRAIGHT | EW_LEFT | M(2, L),
+	[0 * 2 + L] = EW_STRAIGHT | EW_LEFT | M(2, S),
+	[1 * 2 + S] = NS_STRAIGHT | NS_LEFT | M(3, L),
+	[1 * 2 + L] = NS_STRAIGHT | NS_LEFT | M(3, S),
+	[2 * 2 + S] = EW_STRAIGHT | EW_LEFT | M(0, L),
+	[2 * 2 + L] = EW_STRAIGHT | EW_LEFT | M(0, S),
+	[3 * 2 + S] = NS_STRAIGHT | NS_LEFT | M(1, L),
+	[3 * 2 + L] = NS_STRAIGHT | NS_LEFT | M(1, S),
+};
+
+#else
+	#error "ARBITER_CONF_PLAN non valido"
+#endif
+
+#define PHASES		(sizeof(phases) / sizeof(phases[0]))
+
+// Prima fase del piano che contiene almeno un movimento di demand
+static movement_set_t first_phase(movement_set_t demand){
+
+	uint8_t i;
+
+	for(i = 0; i < PHASES; i++)
+		if(phases[i] & demand)
+			return phases[i];
+	return 0;
+
+}
+
+movement_set_t arbiter_decide(movement_set_t normal, movement_set_t emergency){
+
+	movement_set_t demand = normal | emergency;
+	movement_set_t served, pending;
+	uint8_t m;
+
+	// Emergenza prima di tutto, come nella logica originale di TL1/TL2
+	served = first_phase(emergency != 0 ? emergency : demand) & demand;
+
+	// Movimenti richiesti fuori dalla fase ma compatibili con quelli serviti
+	pending = demand & ~served;
+	for(m = 0; pending != 0; m++, pending >>= 1)
+		if((pending & 1) && !(conflicts[m] & served))
+			served |= (movement_set_t) 1 << m;
+
+	return served;
+
+}
@@ -0,0 +1,40 @@
+#ifndef ARBITER_H_
+#define ARBITER_H_
+
+#include <stdint.h>
+
+/*
+ * Arbitraggio dell'incrocio guidato da tabelle.
+ *
+ * Ogni movimento (approccio + svolta) è un bit di un movement_set_t. Il piano
+ * dell'incrocio, scelto a compile time con ARBITER_CONF_PLAN, fornisce:
+ *  - le fasi, cioè gruppi di movimenti compatibili, in ordine di priorità;
+ *  - la matrice dei conflitti: per ogni movimento, i movimenti incompatibili.
+ * La decisione è una scansione di lunghezza fissa con sole operazioni sui bit:
+ * vince la prima fase con un veicolo di emergenza, altrimenti la prima fase con
+ * domanda; poi si aggiungono i movimenti richiesti che non sono in conflitto
+ * con quelli già serviti.
+ */
+
+#define ARBITER_PLAN_2WAY		0	// Due strade che si incrociano, un semaforo per strada (TL1, TL2)
+#define ARBITER_PLAN_3WAY		1	// Incrocio a T: strada principale (approcci 0, 1) e laterale (2)
+#define ARBITER_PLAN_4WAY		2	// Incrocio a 4 vie con svolte a sinistra protette (approcci 0-3)
+
+#ifdef ARBITER_CONF_PLAN
+	#define ARBITER_PLAN		ARBITER_CONF_PLAN
+#else
+	#define ARBITER_PLAN		ARBITER_PLAN_2WAY
+#endif
+
+#define ARBITER_STRAIGHT		0	// Dritto, con svolta a destra
+#define ARBITER_LEFT			1	// Svolta a sinistra
+
+// Bit del movimento di un approccio
+#define ARBITER_MOVE(approach, turn)	((movement_set_t) 1 << ((approach) * 2 + (turn)))
+
+typedef uint16_t movement_set_t;
+
+// Movimenti da servire, data la domanda normale e quella di emergenza
+movement_set_t arbiter_decide(movement_set_t normal, movement_set_t emergency);
+
+#endif /* ARBITER_H_ */
@@ -0,0 +1,23 @@
+#include "deadband.h"
+
+static int16_t distance(int16_t a, int16_t b){
+	return a > b ? a - b : b - a;
+}
+
+int deadband_changed(const deadband_t *db, int16_t temperature, int16_t humidity){
+
+	if(!DEADBAND_ON || !db->valid)
+		return 1;
+
+	return distance(temperature, db->temperature) >= DEADBAND_TEMPERATURE ||
+		distance(humidity, db->humidity) >= DEADBAND_HUMIDITY ||
+		clock_seconds() - db->sent >= DEADBAND_HEARTBEAT;
+
+}
+
+void deadband_sent(deadband_t *db, int16_t temperature, int16_t humidity){
+	db->temperature = temperature;
+	db->humidity = humidity;
+	db->sent = clock_seconds();
+	db->valid = 1;
+}
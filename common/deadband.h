@@ -0,0 +1,54 @@
+#ifndef DEADBAND_H_
+#define DEADBAND_H_
+
+#include "contiki.h"
+
+/*
+ * Invio delle misure solo su variazione: una misura viene trasmessa quando si
+ * scosta dall'ultima inviata di almeno DEADBAND_TEMPERATURE o DEADBAND_HUMIDITY,
+ * oppure quando il nodo tace da DEADBAND_HEARTBEAT secondi (heartbeat, G1 sa
+ * così che il nodo è vivo). G1 tiene l'ultimo valore di un nodo silenzioso come
+ * invariato (SINK_TABLE_HOLD). Con DEADBAND_CONF_ON a 0 ogni misura viene inviata.
+ */
+
+#ifdef DEADBAND_CONF_ON
+	#define DEADBAND_ON				DEADBAND_CONF_ON
+#else
+	#define DEADBAND_ON				0
+#endif
+
+// Variazione minima per inviare, °C
+#ifdef DEADBAND_CONF_TEMPERATURE
+	#define DEADBAND_TEMPERATURE	DEADBAND_CONF_TEMPERATURE
+#else
+	#define DEADBAND_TEMPERATURE	1
+#endif
+
+// Variazione minima per inviare, % RH
+#ifdef DEADBAND_CONF_HUMIDITY
+	#define DEADBAND_HUMIDITY		DEADBAND_CONF_HUMIDITY
+#else
+	#define DEADBAND_HUMIDITY		3
+#endif
+
+// Silenzio massimo, secondi
+#ifdef DEADBAND_CONF_HEARTBEAT
+	#define DEADBAND_HEARTBEAT		DEADBAND_CONF_HEARTBEAT
+#else
+	#define DEADBAND_HEARTBEAT		60
+#endif
+
+typedef struct {
+	int16_t temperature;		// Ultima misura inviata
+	int16_t humidity;
+	unsigned long sent;			// clock_seconds() dell'ultimo invio
+	uint8_t valid;				// Almeno una misura inviata
+} deadband_t;
+
+// Vero se la misura va inviata: variazione oltre soglia o heartbeat scaduto
+int deadband_changed(const deadband_t *db, int16_t temperature, int16_t humidity);
+
+// Registra la misura effettivamente inviata
+void deadband_sent(deadband_t *db, int16_t temperature, int16_t humidity);
+
+#endif /* DEADBAND_H_ */
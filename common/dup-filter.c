@@ -0,0 +1,41 @@
+#include "dup-filter.h"
+
+static dup_filter_entry_t table[DUP_FILTER_SIZE];
+static uint16_t dropped = 0;
+
+int dup_filter_check(const linkaddr_t *from, uint8_t seqno){
+
+	dup_filter_entry_t *e = NULL, *oldest = &table[0];
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < DUP_FILTER_SIZE; i++){
+		if(table[i].valid && linkaddr_cmp(&table[i].addr, from)){
+			e = &table[i];
+			break;
+		}
+		if(!table[i].valid)
+			oldest = &table[i];
+		else if(oldest->valid && now - table[i].heard > now - oldest->heard)
+			oldest = &table[i];
+	}
+
+	if(e == NULL){
+		e = oldest;
+		linkaddr_copy(&e->addr, from);
+		e->valid = 1;
+	}else if(e->seqno == seqno && now - e->heard < DUP_FILTER_LIFETIME){
+		if(dropped < UINT16_MAX)
+			dropped++;
+		return 1;
+	}
+
+	e->seqno = seqno;
+	e->heard = now;
+	return 0;
+
+}
+
+uint16_t dup_filter_dropped(void){
+	return dropped;
+}
@@ -0,0 +1,44 @@
+#ifndef DUP_FILTER_H_
+#define DUP_FILTER_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/*
+ * Filtro dei duplicati runicast in ricezione. Se l'ack va perso il mittente
+ * ritrasmette lo stesso pacchetto con lo stesso seqno runicast: per ogni vicino
+ * viene tenuto l'ultimo seqno accettato e un pacchetto con lo stesso seqno è un
+ * duplicato, da scartare prima di elaborarlo. Un'entry non aggiornata da
+ * DUP_FILTER_LIFETIME non filtra più, così un vicino ripartito da zero non
+ * perde il primo pacchetto. Con la tabella piena viene sostituito il vicino
+ * sentito meno di recente.
+ */
+
+// Vicini ricordati
+#ifdef DUP_FILTER_CONF_SIZE
+	#define DUP_FILTER_SIZE			DUP_FILTER_CONF_SIZE
+#else
+	#define DUP_FILTER_SIZE			4
+#endif
+
+// Secondi, oltre l'ultima ritrasmissione runicast possibile (ritardo raddoppiato a ogni tentativo)
+#ifdef DUP_FILTER_CONF_LIFETIME
+	#define DUP_FILTER_LIFETIME		DUP_FILTER_CONF_LIFETIME
+#else
+	#define DUP_FILTER_LIFETIME		32
+#endif
+
+typedef struct {
+	linkaddr_t addr;
+	uint8_t seqno;				// Ultimo seqno runicast accettato
+	uint8_t valid;
+	unsigned long heard;		// clock_seconds() dell'ultimo pacchetto accettato: clock_time() su Sky fa il giro ogni 512 s
+} dup_filter_entry_t;
+
+// Vero se il pacchetto è un duplicato (contato); altrimenti il seqno viene registrato
+int dup_filter_check(const linkaddr_t *from, uint8_t seqno);
+
+// Duplicati scartati dall'avvio
+uint16_t dup_filter_dropped(void);
+
+#endif /* DUP_FILTER_H_ */
@@ -0,0 +1,149 @@
+#include "energy-acct.h"
+#include "sys/energest.h"
+#include <string.h>
+
+#if ENERGY_ACCT_STATES != ITS_MSG_ENERGY_STATES
+	#error "ITS_MSG_ENERGY_STATES deve coincidere con ENERGY_ACCT_STATES"
+#endif
+
+#define CAPACITY_MC		(ENERGY_ACCT_CAPACITY * 3600UL)		// mAh -> mC
+
+typedef struct {
+	uint32_t mc;				// Carica consumata, mC
+	uint16_t uc;				// Resto in uC, sempre < 1000
+} charge_t;
+
+static charge_t charge[ENERGY_ACCT_STATES];
+static unsigned long last_cpu, last_lpm, last_tx, last_rx;	// Letture energest all'ultimo aggiornamento
+static uint8_t current = ENERGY_IDLE;
+static uint32_t tx_ua = ENERGY_ACCT_TX_UA;					// Corrente di trasmissione alla potenza attuale
+static uint32_t reported[ENERGY_ACCT_STATES];				// Carica per stato all'ultimo report
+static unsigned long reported_radio, reported_time;			// Radio accesa e tempo totale (ticks) all'ultimo report
+
+// Carica (uC) assorbita in ticks di rtimer alla corrente ua, senza overflow a 32 bit
+static uint32_t ticks_to_uc(unsigned long ticks, uint32_t ua){
+	return (ticks / RTIMER_SECOND) * ua + (ticks % RTIMER_SECOND) * ua / RTIMER_SECOND;
+}
+
+static void add(charge_t *c, uint32_t uc){
+	uc += c->uc;
+	c->mc += uc / 1000;
+	c->uc = uc % 1000;
+}
+
+void energy_acct_update(void){
+
+	unsigned long cpu, lpm, tx, rx;
+
+	energest_flush();
+	cpu = energest_type_time(ENERGEST_TYPE_CPU);
+	lpm = energest_type_time(ENERGEST_TYPE_LPM);
+	tx = energest_type_time(ENERGEST_TYPE_TRANSMIT);
+	rx = energest_type_time(ENERGEST_TYPE_LISTEN);
+
+	add(&charge[current], ticks_to_uc(cpu - last_cpu, ENERGY_ACCT_CPU_UA));
+	add(&charge[current], ticks_to_uc(lpm - last_lpm, ENERGY_ACCT_LPM_UA));
+	add(&charge[current], ticks_to_uc(tx - last_tx, tx_ua));
+	add(&charge[current], ticks_to_uc(rx - last_rx, ENERGY_ACCT_RX_UA));
+
+	last_cpu = cpu;
+	last_lpm = lpm;
+	last_tx = tx;
+	last_rx = rx;
+
+}
+
+void energy_acct_txpower(uint8_t level){
+
+	// Datasheet CC2420: corrente ai livelli 3, 7, ..., 31 (da -25 a 0 dBm)
+	static const uint16_t ua[8] = {8500, 9900, 11200, 12500, 13900, 15200, 16500, ENERGY_ACCT_TX_UA};
+
+	energy_acct_update();		// Il tempo di trasmissione finora alla potenza precedente
+	tx_ua = ua[(level > 31 ? 31 : level) >> 2];
+
+}
+
+void energy_acct_init(void){
+	energy_acct_update();
+	energy_acct_recharge();
+}
+
+uint8_t energy_acct_enter(uint8_t state){
+
+	uint8_t previous = current;
+
+	if(state != current && state < ENERGY_ACCT_STATES){
+		energy_acct_update();
+		current = state;
+	}
+	return previous;
+
+}
+
+uint32_t energy_acct_charge(uint8_t state){
+	return state < ENERGY_ACCT_STATES ? charge[state].mc : 0;
+}
+
+uint32_t energy_acct_consumed(void){
+
+	uint32_t total = 0;
+	uint8_t i;
+
+	for(i = 0; i < ENERGY_ACCT_STATES; i++)
+		total += charge[i].mc;
+	return total;
+
+}
+
+void energy_acct_report(its_msg_energy_t *msg, uint8_t period){
+
+	uint16_t delta[ENERGY_ACCT_STATES];		// mC per stato, saturati a 65535
+	unsigned long radio, time;				// Ticks di radio accesa e totali nel periodo
+	uint16_t duty;
+	uint32_t d;
+	uint8_t i;
+
+	for(i = 0; i < ENERGY_ACCT_STATES; i++){
+		d = charge[i].mc - reported[i];
+		delta[i] = d > UINT16_MAX ? UINT16_MAX : d;
+		reported[i] = charge[i].mc;
+	}
+
+	// Duty cycle misurato: con ContikiMAC la radio è accesa solo nei controlli del canale e in trasmissione
+	radio = last_tx + last_rx - reported_radio;
+	time = last_cpu + last_lpm - reported_time;
+	reported_radio = last_tx + last_rx;
+	reported_time = last_cpu + last_lpm;
+	duty = time < 1000 ? 0 : radio / (time / 1000);
+	if(duty > 1000)
+		duty = 1000;
+
+	its_msg_init(&msg->hdr, ITS_MSG_ENERGY);
+	msg->level = energy_acct_level();
+	msg->period = period;
+	memcpy(&msg->radio, &duty, sizeof(duty));
+	memcpy(msg->charge, delta, sizeof(msg->charge));	// Il messaggio è packed: niente accessi a 16 bit disallineati
+
+}
+
+uint8_t energy_acct_level(void){
+
+	uint32_t consumed = energy_acct_consumed();
+
+	if(consumed >= CAPACITY_MC)
+		return 0;
+	return 100 - consumed / (CAPACITY_MC / 100);
+
+}
+
+void energy_acct_recharge(void){
+
+	uint8_t i;
+
+	for(i = 0; i < ENERGY_ACCT_STATES; i++){
+		charge[i].mc = 0;
+		charge[i].uc = 0;
+		reported[i] = 0;
+	}
+
+}
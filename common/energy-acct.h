@@ -0,0 +1,83 @@
+#ifndef ENERGY_ACCT_H_
+#define ENERGY_ACCT_H_
+
+#include "contiki.h"
+#include "its-msg.h"
+
+/*
+ * Contabilità dell'energia per stato del nodo, misurata con energest.
+ *
+ * Il nodo dichiara lo stato in cui si trova con energy_acct_enter(): il tempo
+ * di CPU, LPM, trasmissione e ascolto radio accumulato da energest dall'ultimo
+ * cambio viene convertito in carica con le correnti del Tmote Sky e attribuito
+ * allo stato precedente. La carica (mC) è proporzionale all'energia a tensione
+ * costante; confrontata con la capacità della batteria dà la carica residua
+ * che sostituisce il vecchio battery_level simulato.
+ */
+
+// Stati contabilizzati, comuni a TL e G*
+#define ENERGY_IDLE				0	// In attesa di eventi (G* senza veicoli)
+#define ENERGY_BLINK			1	// TL lampeggiante, nessun veicolo
+#define ENERGY_TRAFFIC			2	// TL: MANAGE_TRAFFIC, rosso e scambio con l'altro TL
+#define ENERGY_GREEN			3	// TL al verde
+#define ENERGY_SENSING			4	// Campionamento e invio delle misure
+#define ENERGY_NOTIFY			5	// G*: classificazione e notifica del veicolo
+#define ENERGY_ACCT_STATES		6
+
+// Capacità della batteria (mAh), 2 stilo AA
+#ifdef ENERGY_ACCT_CONF_CAPACITY
+	#define ENERGY_ACCT_CAPACITY	ENERGY_ACCT_CONF_CAPACITY
+#else
+	#define ENERGY_ACCT_CAPACITY	2500UL
+#endif
+
+// Correnti assorbite (uA), datasheet Tmote Sky / CC2420
+#ifdef ENERGY_ACCT_CONF_CPU_UA
+	#define ENERGY_ACCT_CPU_UA		ENERGY_ACCT_CONF_CPU_UA
+#else
+	#define ENERGY_ACCT_CPU_UA		1800
+#endif
+
+#ifdef ENERGY_ACCT_CONF_LPM_UA
+	#define ENERGY_ACCT_LPM_UA		ENERGY_ACCT_CONF_LPM_UA
+#else
+	#define ENERGY_ACCT_LPM_UA		55
+#endif
+
+#ifdef ENERGY_ACCT_CONF_TX_UA
+	#define ENERGY_ACCT_TX_UA		ENERGY_ACCT_CONF_TX_UA
+#else
+	#define ENERGY_ACCT_TX_UA		17400
+#endif
+
+#ifdef ENERGY_ACCT_CONF_RX_UA
+	#define ENERGY_ACCT_RX_UA		ENERGY_ACCT_CONF_RX_UA
+#else
+	#define ENERGY_ACCT_RX_UA		19700
+#endif
+
+void energy_acct_init(void);
+
+// Entra nello stato indicato e restituisce quello precedente
+uint8_t energy_acct_enter(uint8_t state);
+
+// Attribuisce allo stato corrente il consumo maturato finora
+void energy_acct_update(void);
+
+// Potenza di trasmissione attuale (PA_LEVEL del CC2420, 0-31): la corrente in trasmissione segue il livello
+void energy_acct_txpower(uint8_t level);
+
+// Carica consumata (mC) in uno stato e in totale dall'ultima ricarica
+uint32_t energy_acct_charge(uint8_t state);
+uint32_t energy_acct_consumed(void);
+
+// Compila un report ITS_MSG_ENERGY con i consumi per stato e il duty cycle della radio dal report precedente
+void energy_acct_report(its_msg_energy_t *msg, uint8_t period);
+
+// Carica residua della batteria, 0-100 %
+uint8_t energy_acct_level(void);
+
+// Batteria sostituita: azzera i consumi
+void energy_acct_recharge(void);
+
+#endif /* ENERGY_ACCT_H_ */
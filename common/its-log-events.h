@@ -0,0 +1,50 @@
+/*
+ * Eventi del log (common/its-log.h): ITS_LOG_EVENT(nome, formato).
+ *
+ * Il formato riceve gli argomenti del record nell'ordine, solo %u. Il nodo
+ * trasmette il numero dell'evento (posizione nell'elenco) e gli argomenti; il
+ * testo viene ricostruito sul nodo (ITS_LOG_TEXT) o sull'host da
+ * sim/log-decode.py, che legge questo file: nuovi eventi solo in fondo, così i
+ * log già raccolti restano decodificabili.
+ */
+
+ITS_LOG_EVENT(DROPPED,				"LOG: %u eventi persi")
+
+// Stati dei semafori
+ITS_LOG_EVENT(STATE_BLINK,			"STATO: BLINK")
+ITS_LOG_EVENT(STATE_SEND_NOTIFY_TL,	"STATO: SEND_NOTIFY_TL")
+ITS_LOG_EVENT(STATE_MANAGE_TRAFFIC,	"STATO: MANAGE_TRAFFIC")
+ITS_LOG_EVENT(STATE_RED_TL,			"STATO: RED_TL")
+ITS_LOG_EVENT(STATE_SEND_NOTIFY_CAR,	"STATO: SEND_NOTIFY_CAR")
+ITS_LOG_EVENT(STATE_GREEN_TL,		"STATO: GREEN_TL\tVEICOLI: %u")
+ITS_LOG_EVENT(STATE_RESTORE_TL,		"STATO: RESTORE_TL")
+ITS_LOG_EVENT(TRAFFIC_STATS,		"TRAFFICO: SERVITI %u\tATTESA MEDIA %u s\t%u VEICOLI/MIN")
+
+// Stati dei sensori G*
+ITS_LOG_EVENT(STATE_NONE,			"STATO: NONE")
+ITS_LOG_EVENT(STATE_DEFAULT,			"STATO: DEFAULT")
+ITS_LOG_EVENT(STATE_NOTIFY_VEHICLE,	"STATO: NOTIFY_VEHICLE")
+ITS_LOG_EVENT(STATE_RESTORE_VEHICLE,	"STATO: RESTORE_VEHICLE")
+ITS_LOG_EVENT(GREEN,					"VERDE: TL%u")
+
+// Radio: indirizzi come primo byte (tutti i nodi sono X.0)
+ITS_LOG_EVENT(RUNICAST_RECV,			"DEBUG: runicast message received from %u.0, seqno %u, type %u")
+ITS_LOG_EVENT(RUNICAST_SENT,			"DEBUG: runicast message sent to %u.0, retransmissions %u")
+ITS_LOG_EVENT(RUNICAST_TIMEOUT,		"//// Timeout %u.0")
+ITS_LOG_EVENT(BROADCAST_RECV,		"DEBUG: broadcast message received from %u.0, type %u")
+ITS_LOG_EVENT(BROADCAST_SENT,		"DEBUG: broadcast message sent, status %u, tx %u")
+
+// Coda di trasmissione (common/tx-queue.h)
+ITS_LOG_EVENT(TX_DROPPED,			"DEBUG: coda di trasmissione piena, scartato messaggio tipo %u classe %u")
+
+// Preemption per i veicoli di emergenza: emergenze in coda sulla propria strada e sull'altra
+ITS_LOG_EVENT(PREEMPT,				"STATO: PREEMPTION\tEMERGENZE %u/%u")
+
+// Duplicato runicast scartato (common/dup-filter.h): mittente, seqno, duplicati dall'avvio
+ITS_LOG_EVENT(RUNICAST_DUP,			"DEBUG: duplicato da %u.0, seqno %u, scartati %u")
+
+// Misure ricevute dal sink: mittente, epoca della prima misura, misure nel frame
+ITS_LOG_EVENT(SENSE_RECV,			"DEBUG: misure da %u.0, epoca %u, %u misure")
+
+// Misure scartate dal sink con la tabella di aggregazione piena: mittente
+ITS_LOG_EVENT(SINK_FULL,			"WARNING: sink table piena, misure di %u.0 scartate")
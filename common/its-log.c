@@ -0,0 +1,84 @@
+#include "its-log.h"
+#include <stdio.h>
+
+#if ITS_LOG_TEXT
+	#define ITS_LOG_EVENT(name, format)	format,
+	static const char *const formats[ITS_LOG_EVENTS] = {
+		#include "its-log-events.h"
+	};
+	#undef ITS_LOG_EVENT
+#endif
+
+static its_log_record_t ring[ITS_LOG_SIZE];
+static uint8_t head = 0;			// Prossimo record da scrivere
+static uint8_t tail = 0;			// Prossimo record da stampare
+static uint16_t dropped = 0;		// Record scartati con il buffer pieno
+
+PROCESS(its_log_process, "Log drain");
+
+void its_log_init(void){
+	process_start(&its_log_process, NULL);
+}
+
+void its_log_put(uint8_t module, uint8_t level, uint8_t event, uint16_t a, uint16_t b, uint16_t c){
+
+	its_log_record_t *r;
+
+	if((uint8_t) (head - tail) == ITS_LOG_SIZE){
+		if(dropped < UINT16_MAX)
+			dropped++;
+		return;
+	}
+	r = &ring[head % ITS_LOG_SIZE];
+	r->time = clock_time();
+	r->event = event;
+	r->level = (module << 4) | level;
+	r->arg[0] = a;
+	r->arg[1] = b;
+	r->arg[2] = c;
+	head++;
+	process_poll(&its_log_process);
+
+}
+
+static void print_record(const its_log_record_t *r){
+	#if ITS_LOG_TEXT
+		printf(formats[r->event], r->arg[0], r->arg[1], r->arg[2]);
+		putchar('\n');
+	#else
+		printf("@L%04x%02x%02x%04x%04x%04x\n", r->time, r->event, r->level, r->arg[0], r->arg[1], r->arg[2]);
+	#endif
+}
+
+PROCESS_THREAD(its_log_process, ev, data){
+
+	static its_log_record_t lost;
+
+	PROCESS_BEGIN();
+
+	while(1){
+
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL);
+
+		// Un record per giro dello scheduler: gli eventi in coda vengono serviti prima del successivo
+		while(head != tail){
+			print_record(&ring[tail % ITS_LOG_SIZE]);
+			tail++;
+			PROCESS_PAUSE();
+		}
+
+		// Buffer vuoto: i record persi vengono segnalati in coda a quelli stampati
+		if(dropped){
+			lost.time = clock_time();
+			lost.event = ITS_LOG_EV_DROPPED;
+			lost.level = (ITS_LOG_MOD_LOG << 4) | ITS_LOG_LEVEL_ERR;
+			lost.arg[0] = dropped;
+			dropped = 0;
+			print_record(&lost);
+		}
+
+	}
+
+	PROCESS_END();
+
+}
@@ -0,0 +1,98 @@
+#ifndef ITS_LOG_H_
+#define ITS_LOG_H_
+
+#include "contiki.h"
+
+/*
+ * Log non bloccante: le callback Rime e le transizioni di stato scrivono un
+ * record binario (evento e fino a 3 argomenti) in un buffer circolare in RAM,
+ * senza toccare la UART. Il processo its_log_process svuota il buffer sulla
+ * seriale un record per volta, cedendo la CPU tra un record e l'altro, quindi
+ * gli eventi dei processi ITS passano sempre avanti. Con il buffer pieno i
+ * nuovi record vengono scartati e contati (evento DROPPED).
+ *
+ * Sulla seriale un record è una riga
+ *   @L<tempo><evento><livello><arg0><arg1><arg2>
+ * in esadecimale (4, 2, 2, 4, 4, 4 cifre; tempo in tick di clock_time()),
+ * decodificata da sim/log-decode.py con i formati di its-log-events.h. Con
+ * ITS_LOG_TEXT (default sul target native) il nodo stampa direttamente il testo.
+ *
+ * Ogni modulo ha un livello fissato a compilazione (ITS_LOG_CONF_LEVEL_<MODULO>):
+ * le chiamate sopra il livello spariscono dal codice.
+ */
+
+#define ITS_LOG_LEVEL_NONE		0
+#define ITS_LOG_LEVEL_ERR		1
+#define ITS_LOG_LEVEL_INFO		2
+#define ITS_LOG_LEVEL_DBG		3
+
+// Moduli: TRAFFIC stati e verdi, RADIO callback Rime
+#define ITS_LOG_MOD_LOG			0
+#define ITS_LOG_MOD_TRAFFIC		1
+#define ITS_LOG_MOD_RADIO		2
+
+#define ITS_LOG_LEVEL_LOG		ITS_LOG_LEVEL_ERR
+
+#ifdef ITS_LOG_CONF_LEVEL_TRAFFIC
+	#define ITS_LOG_LEVEL_TRAFFIC	ITS_LOG_CONF_LEVEL_TRAFFIC
+#else
+	#define ITS_LOG_LEVEL_TRAFFIC	ITS_LOG_LEVEL_INFO
+#endif
+
+#ifdef ITS_LOG_CONF_LEVEL_RADIO
+	#define ITS_LOG_LEVEL_RADIO		ITS_LOG_CONF_LEVEL_RADIO
+#else
+	#define ITS_LOG_LEVEL_RADIO		ITS_LOG_LEVEL_DBG
+#endif
+
+// Record nel buffer: potenza di 2, al più 128
+#ifdef ITS_LOG_CONF_SIZE
+	#define ITS_LOG_SIZE			ITS_LOG_CONF_SIZE
+#else
+	#define ITS_LOG_SIZE			32
+#endif
+
+// Testo al posto dei record esadecimali
+#ifdef ITS_LOG_CONF_TEXT
+	#define ITS_LOG_TEXT			ITS_LOG_CONF_TEXT
+#elif CONTIKI_TARGET_NATIVE
+	#define ITS_LOG_TEXT			1
+#else
+	#define ITS_LOG_TEXT			0
+#endif
+
+#define ITS_LOG_EVENT(name, format)	ITS_LOG_EV_##name,
+enum {
+	#include "its-log-events.h"
+	ITS_LOG_EVENTS
+};
+#undef ITS_LOG_EVENT
+
+typedef struct {
+	uint16_t time;				// clock_time() all'evento
+	uint8_t event;
+	uint8_t level;				// (modulo << 4) | livello
+	uint16_t arg[3];
+} its_log_record_t;
+
+PROCESS_NAME(its_log_process);
+
+// Avvia lo svuotamento del buffer sulla seriale
+void its_log_init(void);
+
+void its_log_put(uint8_t module, uint8_t level, uint8_t event, uint16_t a, uint16_t b, uint16_t c);
+
+/*
+ * ITS_LOG_INFO(TRAFFIC, STATE_GREEN_TL, veicoli): modulo ed evento senza
+ * prefisso, argomenti mancanti a 0.
+ */
+#define ITS_LOG_(level, module, event, a, b, c, ...) \
+	do { \
+		if(ITS_LOG_LEVEL_##level <= ITS_LOG_LEVEL_##module) \
+			its_log_put(ITS_LOG_MOD_##module, ITS_LOG_LEVEL_##level, ITS_LOG_EV_##event, (a), (b), (c)); \
+	} while(0)
+#define ITS_LOG_ERR(module, ...)		ITS_LOG_(ERR, module, __VA_ARGS__, 0, 0, 0, 0)
+#define ITS_LOG_INFO(module, ...)		ITS_LOG_(INFO, module, __VA_ARGS__, 0, 0, 0, 0)
+#define ITS_LOG_DBG(module, ...)		ITS_LOG_(DBG, module, __VA_ARGS__, 0, 0, 0, 0)
+
+#endif /* ITS_LOG_H_ */
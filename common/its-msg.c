@@ -0,0 +1,26 @@
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "its-msg.h"
+
+static uint8_t seqno = 0;		// Numero di sequenza dell'ultimo messaggio inviato
+
+void its_msg_init(its_msg_hdr_t *hdr, uint8_t type){
+	hdr->version_type = (ITS_MSG_VERSION << 4) | (type & 0x0f);
+	hdr->seqno = ++seqno;
+}
+
+uint8_t its_msg_type(void){
+
+	const its_msg_hdr_t *hdr = packetbuf_dataptr();
+
+	if(packetbuf_datalen() < sizeof(its_msg_hdr_t) || (hdr->version_type >> 4) != ITS_MSG_VERSION)
+		return 0;
+	return hdr->version_type & 0x0f;
+
+}
+
+const void *its_msg_get(uint8_t type, uint16_t size){
+	if(its_msg_type() != type || packetbuf_datalen() < size)
+		return NULL;
+	return packetbuf_dataptr();
+}
@@ -0,0 +1,118 @@
+#ifndef ITS_MSG_H_
+#define ITS_MSG_H_
+
+#include <stdint.h>
+
+/*
+ * Formato dei messaggi scambiati via radio da G1, G2, TL1 e TL2, comune alle
+ * versioni Broadcast e Unicast.
+ *
+ * Ogni frame inizia con un header di 2 byte:
+ *  - byte 0: versione del formato (4 bit alti) e tipo di messaggio (4 bit bassi)
+ *  - byte 1: numero di sequenza del mittente
+ * seguito da un payload a campi fissi. Le strutture sono packed e i campi a più
+ * byte sono little-endian (come su MSP430 e x86), quindi un frame ricevuto si
+ * legge sul posto da packetbuf_dataptr() senza copie né parsing.
+ */
+
+#define ITS_MSG_VERSION			1
+
+#define ITS_MSG_VEHICLE			1	// G* -> TL*: veicolo in arrivo
+#define ITS_MSG_GREEN			2	// TL* -> G*: verde concesso al veicolo
+#define ITS_MSG_SENSE			3	// G2, TL* -> G1: misura di sensing
+#define ITS_MSG_DEMAND			4	// TL* -> TL*: veicoli in coda sul proprio approccio
+#define ITS_MSG_ENERGY			5	// G2, TL* -> G1: consumi per stato e carica residua
+#define ITS_MSG_BATCH			6	// G2, TL* -> G1: più misure di sensing in un frame
+#define ITS_MSG_UPGRADE			7	// G* -> TL*: l'ultimo veicolo notificato è un'emergenza
+
+#define ITS_MSG_ENERGY_CHANNEL	152	// Canale broadcast dei report di energia, separato dal traffico
+#define ITS_MSG_ENERGY_STATES	6	// ENERGY_ACCT_STATES (energy-acct.h)
+#define ITS_MSG_BATCH_MAX		8	// Misure al massimo in un ITS_MSG_BATCH
+
+typedef struct {
+	uint8_t version_type;
+	uint8_t seqno;
+} __attribute__((packed)) its_msg_hdr_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t vehicle;			// vehicle_t: NONE, NORMAL, EMERGENCY
+	uint16_t age;				// Tick del mittente dall'evento all'invio: pressione (VEHICLE), decisione del TL (GREEN)
+} __attribute__((packed)) its_msg_vehicle_t;
+
+// Veicoli contati dal G* dal proprio avvio, per classe (un upgrade sposta un veicolo da normal a emergency).
+// Il TL ricava gli arrivi dalla differenza con l'ultimo report visto, quindi un report perso non perde veicoli
+typedef struct {
+	uint16_t normal;
+	uint16_t emergency;
+	uint8_t boot;				// Avvio del G*, 1-255 dalla prima pressione: cambia quando i conteggi ripartono da zero
+} __attribute__((packed)) its_msg_count_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t vehicle;			// Classe dell'ultimo veicolo
+	uint16_t age;				// Tick dalla sua pressione all'invio
+	its_msg_count_t count;
+} __attribute__((packed)) its_msg_notify_t;
+
+// Il G* notifica il veicolo alla prima pressione come normale; una seconda pressione entro la finestra lo promuove
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint16_t age;				// Tick dalla prima pressione all'invio
+	its_msg_count_t count;		// Conteggi già aggiornati con l'upgrade
+} __attribute__((packed)) its_msg_upgrade_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t epoch;				// Round di campionamento del mittente, usato da G1 per le finestre
+	uint16_t timestamp;			// Istante del campionamento, clock_seconds() del mittente
+	int16_t temperature;		// °C
+	int16_t humidity;			// % RH, già compensata in temperatura
+} __attribute__((packed)) its_msg_sense_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t normal;				// Veicoli normali in coda
+	uint8_t emergency;			// Veicoli di emergenza in coda
+	uint8_t red;				// 1: il mittente è al rosso per l'emergenza della DEMAND confirm
+	uint8_t confirm;			// Seqno dell'ultima DEMAND con emergenze ricevuta dal mittente
+} __attribute__((packed)) its_msg_demand_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t level;								// Carica residua, %
+	uint8_t period;								// Secondi coperti dal report
+	uint16_t radio;								// Radio accesa (ascolto + trasmissione) nel periodo, per mille
+	uint16_t charge[ITS_MSG_ENERGY_STATES];		// mC consumati in ogni stato nel periodo
+} __attribute__((packed)) its_msg_energy_t;
+
+// Misura di un batch codificata come differenza dalla precedente
+typedef struct {
+	uint8_t dt;					// Secondi dalla misura precedente
+	int8_t temperature;			// °C
+	int8_t humidity;			// % RH
+} __attribute__((packed)) its_msg_delta_t;
+
+typedef struct {
+	its_msg_hdr_t hdr;
+	uint8_t epoch;				// Epoca della prima misura, le successive sono consecutive
+	uint8_t count;				// Misure nel batch, 1..ITS_MSG_BATCH_MAX
+	uint16_t timestamp;			// Prima misura per intero, come in its_msg_sense_t
+	int16_t temperature;
+	int16_t humidity;
+	its_msg_delta_t delta[ITS_MSG_BATCH_MAX - 1];	// Misure successive, solo le prime count - 1 vengono trasmesse
+} __attribute__((packed)) its_msg_batch_t;
+
+// Lunghezza in byte di un batch di n misure
+#define its_msg_batch_size(n)	(sizeof(its_msg_batch_t) - (ITS_MSG_BATCH_MAX - (n)) * sizeof(its_msg_delta_t))
+
+// Inizializza l'header con il tipo indicato e il prossimo numero di sequenza
+void its_msg_init(its_msg_hdr_t *hdr, uint8_t type);
+
+// Tipo del messaggio in packetbuf, 0 se il frame non è valido
+uint8_t its_msg_type(void);
+
+// Puntatore al messaggio in packetbuf se è del tipo e della lunghezza attesi, altrimenti NULL
+const void *its_msg_get(uint8_t type, uint16_t size);
+
+#endif /* ITS_MSG_H_ */
@@ -0,0 +1,42 @@
+#include "latency.h"
+#include <stdio.h>
+
+static unsigned long to_ms(uint32_t ticks){
+	return ticks * 1000UL / CLOCK_SECOND;
+}
+
+void latency_add(latency_hist_t *h, clock_time_t ticks){
+
+	uint8_t i = 0;
+
+	while(i < LATENCY_BINS - 1 && ticks >= ((clock_time_t) LATENCY_UNIT << i))
+		i++;
+	if(h->bin[i] < UINT16_MAX)
+		h->bin[i]++;
+	if(h->count < UINT16_MAX)
+		h->count++;
+	if(ticks > h->max)
+		h->max = ticks;
+	h->sum += ticks;
+
+}
+
+void latency_print(const latency_hist_t *h){
+
+	uint8_t i;
+
+	printf("LAT: %s\tN %u\tMEDIA %lu ms\tMAX %lu ms\t", h->name, h->count,
+		h->count ? to_ms(h->sum / h->count) : 0, to_ms(h->max));
+	for(i = 0; i < LATENCY_BINS - 1; i++)
+		printf("<%lu:%u ", to_ms((uint32_t) LATENCY_UNIT << i), h->bin[i]);
+	printf(">=%lu:%u\n", to_ms((uint32_t) LATENCY_UNIT << (LATENCY_BINS - 2)), h->bin[LATENCY_BINS - 1]);
+
+}
+
+void latency_pending_push(latency_pending_t *p, clock_time_t press, clock_time_t recv){
+	if(p->count == LATENCY_PENDING)
+		return;
+	p->press[p->count] = press;
+	p->recv[p->count] = recv;
+	p->count++;
+}
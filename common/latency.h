@@ -0,0 +1,50 @@
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include "contiki.h"
+
+/*
+ * Latenza dei veicoli, dalla pressione del pulsante su G* al verde del TL.
+ *
+ * Ogni nodo misura con clock_time() solo intervalli sul proprio clock: i tempi
+ * attraversano la radio come età (campo age dei messaggi, tick trascorsi
+ * dall'evento all'invio), quindi non serve sincronizzare i nodi. Gli intervalli
+ * finiscono in istogrammi logaritmici sul nodo, stampati con il comando
+ * seriale "LAT":
+ *   LAT: <nome>	N <campioni>	MEDIA <ms>	MAX <ms>	<limite_ms>:<campioni> ...
+ * Il bin i conta le latenze sotto LATENCY_UNIT * 2^i, l'ultimo tutte le altre.
+ */
+
+#define LATENCY_BINS			10
+#define LATENCY_UNIT			(CLOCK_SECOND / 8)		// Primo bin: 125 ms, ultimo limite 32 s
+
+// Veicoli in attesa del verde di cui si tengono i tempi
+#ifdef LATENCY_CONF_PENDING
+	#define LATENCY_PENDING		LATENCY_CONF_PENDING
+#else
+	#define LATENCY_PENDING		8
+#endif
+
+typedef struct {
+	const char *name;
+	uint16_t bin[LATENCY_BINS];
+	uint16_t count;
+	clock_time_t max;
+	uint32_t sum;				// Tick
+} latency_hist_t;
+
+// Tempi dei veicoli in coda, sul clock del nodo
+typedef struct {
+	clock_time_t press[LATENCY_PENDING];	// Pressione del pulsante
+	clock_time_t recv[LATENCY_PENDING];		// Arrivo della notifica al nodo
+	uint8_t count;
+} latency_pending_t;
+
+void latency_add(latency_hist_t *h, clock_time_t ticks);
+void latency_print(const latency_hist_t *h);
+
+// Accoda un veicolo; oltre LATENCY_PENDING i veicoli restano in coda ma senza tempi
+void latency_pending_push(latency_pending_t *p, clock_time_t press, clock_time_t recv);
+#define latency_pending_clear(p)	((p)->count = 0)
+
+#endif /* LATENCY_H_ */
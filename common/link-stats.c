@@ -0,0 +1,123 @@
+#include "link-stats.h"
+#include "net/packetbuf.h"
+#include <stdio.h>
+#include <string.h>
+
+static link_stats_t table[LINK_STATS_SIZE];
+
+static link_stats_t *find(const linkaddr_t *addr, int create){
+
+	link_stats_t *oldest = &table[0];
+	unsigned long now = clock_seconds();
+	uint8_t i;
+
+	for(i = 0; i < LINK_STATS_SIZE; i++){
+		if(table[i].valid && linkaddr_cmp(&table[i].addr, addr))
+			return &table[i];
+		if(!table[i].valid)
+			oldest = &table[i];
+		else if(oldest->valid && now - table[i].updated > now - oldest->updated)
+			oldest = &table[i];
+	}
+
+	if(!create)
+		return NULL;
+	memset(oldest, 0, sizeof(*oldest));
+	linkaddr_copy(&oldest->addr, addr);
+	oldest->prr = 100;			// Nessun invio: il collegamento è considerato buono
+	oldest->power = LINK_STATS_POWER_MAX;
+	oldest->valid = 1;
+	return oldest;
+
+}
+
+const link_stats_t *link_stats_lookup(const linkaddr_t *addr){
+	return find(addr, 0);
+}
+
+void link_stats_tx(const linkaddr_t *to, uint8_t retransmissions, int acked){
+
+	link_stats_t *l = find(to, 1);
+	uint8_t sample = acked ? 100 / (retransmissions + 1) : 0;	// Tentativi riusciti sul totale
+
+	if(l->sent < UINT16_MAX)
+		l->sent++;
+	if(acked && l->acked < UINT16_MAX)
+		l->acked++;
+	if(l->retx <= UINT16_MAX - retransmissions)
+		l->retx += retransmissions;
+	l->prr = ((uint16_t) l->prr * 3 + sample) / 4;
+	if(acked)
+		l->failures = 0;
+	else{
+		if(l->failures < UINT8_MAX)
+			l->failures++;
+		l->failed = clock_seconds();
+	}
+	l->updated = clock_seconds();
+
+	#if LINK_STATS_POWER
+		if(!acked){
+			l->power = LINK_STATS_POWER_MAX;
+			l->clean = 0;
+		}else if(retransmissions > 0){
+			l->power = l->power + LINK_STATS_POWER_STEP * retransmissions > LINK_STATS_POWER_MAX ?
+				LINK_STATS_POWER_MAX : l->power + LINK_STATS_POWER_STEP * retransmissions;
+			l->clean = 0;
+		}else if(++l->clean >= LINK_STATS_POWER_PROBE){
+			if(l->prr >= LINK_STATS_POWER_TARGET && l->power >= LINK_STATS_POWER_MIN + LINK_STATS_POWER_STEP)
+				l->power -= LINK_STATS_POWER_STEP;
+			l->clean = 0;
+		}
+	#endif
+
+}
+
+uint8_t link_stats_power(const linkaddr_t *to){
+	const link_stats_t *l = find(to, 0);
+	return l != NULL ? l->power : LINK_STATS_POWER_MAX;
+}
+
+void link_stats_rx(const linkaddr_t *from){
+
+	link_stats_t *l = find(from, 1);
+	int8_t rssi = (int8_t) packetbuf_attr(PACKETBUF_ATTR_RSSI);
+	uint8_t lqi = packetbuf_attr(PACKETBUF_ATTR_LINK_QUALITY);
+
+	if(l->heard){
+		l->rssi = ((int16_t) l->rssi * 3 + rssi) / 4;
+		l->lqi = ((uint16_t) l->lqi * 3 + lqi) / 4;
+	}else{
+		l->rssi = rssi;
+		l->lqi = lqi;
+		l->heard = 1;
+	}
+	l->updated = clock_seconds();
+
+}
+
+clock_time_t link_stats_backoff(const linkaddr_t *to){
+
+	const link_stats_t *l = find(to, 0);
+	clock_time_t hold;
+	unsigned long elapsed;
+
+	if(l == NULL || l->failures == 0)
+		return 0;
+	hold = LINK_STATS_BACKOFF << (l->failures > 4 ? 3 : l->failures - 1);
+	elapsed = clock_seconds() - l->failed;		// Al secondo: basta per attese di qualche secondo
+	return elapsed >= hold / CLOCK_SECOND ? 0 : hold - (clock_time_t) elapsed * CLOCK_SECOND;
+
+}
+
+void link_stats_print(void){
+
+	uint8_t i;
+
+	for(i = 0; i < LINK_STATS_SIZE; i++)
+		if(table[i].valid)
+			printf("LINK: %u.%u\tTX %u\tOK %u\tRETX %u\tPRR %u%%\tRSSI %d\tLQI %u\tPOTENZA %u\n",
+				table[i].addr.u8[0], table[i].addr.u8[1], table[i].sent, table[i].acked,
+				table[i].retx, table[i].prr, table[i].rssi, table[i].lqi, table[i].power);
+
+}
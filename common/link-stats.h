@@ -0,0 +1,122 @@
+#ifndef LINK_STATS_H_
+#define LINK_STATS_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/*
+ * Statistiche per vicino: pacchetti runicast inviati, consegnati e
+ * ritrasmessi (callback sent/timedout, tramite tx_queue_done), PRR dei
+ * tentativi come media mobile in percentuale, RSSI e LQI medi dei pacchetti
+ * ricevuti dal vicino (attributi del packetbuf nelle callback di ricezione).
+ *
+ * La coda di trasmissione (tx-queue.h) usa il PRR per scegliere le
+ * ritrasmissioni di ogni invio e il ritardo della telemetria dopo timeout
+ * consecutivi. Con la tabella piena viene sostituito il vicino aggiornato meno
+ * di recente.
+ *
+ * Controllo della potenza (LINK_STATS_POWER): ogni vicino parte dalla potenza
+ * massima; dopo LINK_STATS_POWER_PROBE invii consecutivi consegnati al primo
+ * tentativo, con PRR almeno LINK_STATS_POWER_TARGET, la potenza scende di un
+ * passo. Ogni ritrasmissione la rialza di un passo e un timeout la riporta al
+ * massimo, quindi il livello si assesta appena sopra il minimo che il
+ * collegamento sopporta. I livelli sono il PA_LEVEL del CC2420 (0-31).
+ */
+
+// Vicini seguiti
+#ifdef LINK_STATS_CONF_SIZE
+	#define LINK_STATS_SIZE			LINK_STATS_CONF_SIZE
+#else
+	#define LINK_STATS_SIZE			4
+#endif
+
+// Soglie di PRR (%): sotto POOR il collegamento è scarso, da GOOD in su è buono
+#ifdef LINK_STATS_CONF_POOR
+	#define LINK_STATS_POOR			LINK_STATS_CONF_POOR
+#else
+	#define LINK_STATS_POOR			50
+#endif
+
+#ifdef LINK_STATS_CONF_GOOD
+	#define LINK_STATS_GOOD			LINK_STATS_CONF_GOOD
+#else
+	#define LINK_STATS_GOOD			90
+#endif
+
+// Attesa dopo il primo timeout, raddoppiata a ogni timeout consecutivo (al più 8 volte)
+#ifdef LINK_STATS_CONF_BACKOFF
+	#define LINK_STATS_BACKOFF		LINK_STATS_CONF_BACKOFF
+#else
+	#define LINK_STATS_BACKOFF		(CLOCK_SECOND * 4)
+#endif
+
+#ifdef LINK_STATS_CONF_POWER
+	#define LINK_STATS_POWER		LINK_STATS_CONF_POWER
+#else
+	#define LINK_STATS_POWER		1
+#endif
+
+// 31 è 0 dBm, 3 è -25 dBm; un passo di 4 livelli vale circa 2-5 dB
+#define LINK_STATS_POWER_MAX		31
+
+#ifdef LINK_STATS_CONF_POWER_MIN
+	#define LINK_STATS_POWER_MIN	LINK_STATS_CONF_POWER_MIN
+#else
+	#define LINK_STATS_POWER_MIN	3
+#endif
+
+#ifdef LINK_STATS_CONF_POWER_STEP
+	#define LINK_STATS_POWER_STEP	LINK_STATS_CONF_POWER_STEP
+#else
+	#define LINK_STATS_POWER_STEP	4
+#endif
+
+#ifdef LINK_STATS_CONF_POWER_PROBE
+	#define LINK_STATS_POWER_PROBE	LINK_STATS_CONF_POWER_PROBE
+#else
+	#define LINK_STATS_POWER_PROBE	8
+#endif
+
+// PRR (%) sotto il quale la potenza non scende
+#ifdef LINK_STATS_CONF_POWER_TARGET
+	#define LINK_STATS_POWER_TARGET	LINK_STATS_CONF_POWER_TARGET
+#else
+	#define LINK_STATS_POWER_TARGET	LINK_STATS_GOOD
+#endif
+
+typedef struct {
+	linkaddr_t addr;
+	uint16_t sent;				// Pacchetti runicast inviati
+	uint16_t acked;				// Consegnati
+	uint16_t retx;				// Ritrasmissioni totali
+	uint8_t prr;				// Media mobile dei tentativi riusciti, %
+	uint8_t failures;			// Timeout consecutivi
+	uint8_t power;				// Potenza di trasmissione verso il vicino
+	uint8_t clean;				// Invii consecutivi consegnati al primo tentativo
+	int8_t rssi;				// Media mobile sui pacchetti ricevuti
+	uint8_t lqi;
+	uint8_t valid;
+	uint8_t heard;				// Almeno un pacchetto ricevuto (rssi e lqi validi)
+	unsigned long updated;		// clock_seconds() dell'ultimo aggiornamento: clock_time() su Sky fa il giro ogni 512 s
+	unsigned long failed;		// clock_seconds() dell'ultimo timeout
+} link_stats_t;
+
+// Entry del vicino, NULL se non è in tabella
+const link_stats_t *link_stats_lookup(const linkaddr_t *addr);
+
+// Esito di un invio runicast: retransmissions dalla callback, acked 0 per timeout
+void link_stats_tx(const linkaddr_t *to, uint8_t retransmissions, int acked);
+
+// Da chiamare nelle callback di ricezione, finché il packetbuf contiene il pacchetto
+void link_stats_rx(const linkaddr_t *from);
+
+// Potenza con cui inviare al vicino, LINK_STATS_POWER_MAX se non è in tabella
+uint8_t link_stats_power(const linkaddr_t *to);
+
+// Tick da attendere prima di inviare telemetria al vicino, 0 se non ha timeout recenti
+clock_time_t link_stats_backoff(const linkaddr_t *to);
+
+// Una riga "LINK:" per vicino sulla seriale
+void link_stats_print(void);
+
+#endif /* LINK_STATS_H_ */
@@ -0,0 +1,99 @@
+#include "phase-timing.h"
+
+#define EWMA_SHIFT		2		// Peso 1/4 del nuovo campione nella media dei tempi fra arrivi
+#define LONG_GAP		255		// Secondi oltre i quali il tempo dall'ultimo arrivo satura, entro metà giro di clock_time() su Sky
+
+// Tick dall'ultimo arrivo: oltre LONG_GAP secondi la differenza di clock_time() non è affidabile
+static clock_time_t since_arrival(const phase_timing_t *pt){
+	if(clock_seconds() - pt->last_seconds >= LONG_GAP)
+		return (clock_time_t) LONG_GAP * CLOCK_SECOND;
+	return clock_time() - pt->last_arrival;
+}
+
+void phase_timing_init(phase_timing_t *pt){
+	pt->last_arrival = clock_time();
+	pt->last_seconds = clock_seconds();
+	pt->interval = 0;
+	pt->arrival_sum = 0;
+	pt->wait_sum = 0;
+	pt->served = 0;
+	pt->start = clock_seconds();
+}
+
+void phase_timing_arrival(phase_timing_t *pt){
+
+	clock_time_t sample = since_arrival(pt);
+
+	if(pt->interval == 0)
+		pt->interval = sample;
+	else
+		pt->interval = pt->interval - (pt->interval >> EWMA_SHIFT) + (sample >> EWMA_SHIFT);
+
+	pt->last_arrival = clock_time();
+	pt->last_seconds = clock_seconds();
+	pt->arrival_sum += pt->last_seconds;
+
+}
+
+clock_time_t phase_timing_green(const phase_timing_t *pt, const vehicle_queue_t *q){
+
+	uint32_t green = (uint32_t) PHASE_TIMING_HEADWAY * vehicle_queue_length(q);
+	uint32_t max = q->emergency != 0 ? PHASE_TIMING_EMERGENCY_GREEN : PHASE_TIMING_MAX_GREEN;
+
+	// Veicoli che arrivano durante lo smaltimento: un arrivo ogni interval
+	if(q->emergency == 0 && pt->interval != 0){
+		if(pt->interval <= PHASE_TIMING_HEADWAY)
+			green = max;		// Arrivano più veicoli di quanti se ne smaltiscono
+		else
+			green += green * PHASE_TIMING_HEADWAY / (pt->interval - PHASE_TIMING_HEADWAY);
+	}
+
+	if(green < PHASE_TIMING_MIN_GREEN)
+		green = PHASE_TIMING_MIN_GREEN;
+	if(green > max)
+		green = max;
+	return (clock_time_t) green;
+
+}
+
+void phase_timing_served(phase_timing_t *pt, const vehicle_queue_t *q){
+
+	uint16_t vehicles = vehicle_queue_length(q);
+
+	pt->wait_sum += (uint32_t) vehicles * clock_seconds() - pt->arrival_sum;
+	pt->served += vehicles;
+	pt->arrival_sum = 0;
+
+}
+
+void phase_timing_discard(phase_timing_t *pt){
+	pt->arrival_sum = 0;
+}
+
+uint8_t phase_timing_activity(const phase_timing_t *pt){
+
+	clock_time_t interval = pt->interval;
+	clock_time_t silence = since_arrival(pt);
+	unsigned long rate;
+
+	if(interval == 0)
+		return 0;
+	if(silence > interval)		// Nessun arrivo da più di un intervallo medio: il ritmo sta calando
+		interval = silence;
+
+	rate = (unsigned long) CLOCK_SECOND * 60 / interval;
+	return rate > UINT8_MAX ? UINT8_MAX : rate;
+
+}
+
+unsigned long phase_timing_avg_wait(const phase_timing_t *pt){
+	return pt->served != 0 ? pt->wait_sum / pt->served : 0;
+}
+
+unsigned long phase_timing_rate(const phase_timing_t *pt){
+
+	unsigned long elapsed = clock_seconds() - pt->start;
+
+	return elapsed != 0 ? (unsigned long) pt->served * 60 / elapsed : 0;
+
+}
@@ -0,0 +1,77 @@
+#ifndef PHASE_TIMING_H_
+#define PHASE_TIMING_H_
+
+#include "contiki.h"
+#include "vehicle-queue.h"
+
+/*
+ * Durata delle fasi del semaforo in funzione della domanda misurata su un
+ * approccio. Il verde dura il tempo di smaltire la coda (PHASE_TIMING_HEADWAY
+ * per veicolo) più i veicoli che, al ritmo di arrivo stimato, si accodano nel
+ * frattempo, entro [PHASE_TIMING_MIN_GREEN, PHASE_TIMING_MAX_GREEN]. Con un
+ * veicolo di emergenza in coda la fase non viene allungata oltre
+ * PHASE_TIMING_EMERGENCY_GREEN, così l'altra strada torna presto al verde.
+ * Finito lo smaltimento il verde termina: un approccio vuoto non trattiene la fase.
+ *
+ * Il modulo tiene anche le statistiche di servizio: l'attesa di tutti i veicoli
+ * in coda si ottiene in tempo costante dalla somma dei loro istanti di arrivo
+ * (attesa totale = veicoli * istante del verde - somma degli arrivi).
+ */
+
+// Tempo di smaltimento di un veicolo in coda
+#ifdef PHASE_TIMING_CONF_HEADWAY
+	#define PHASE_TIMING_HEADWAY			PHASE_TIMING_CONF_HEADWAY
+#else
+	#define PHASE_TIMING_HEADWAY			(CLOCK_SECOND * 2)
+#endif
+
+#ifdef PHASE_TIMING_CONF_MIN_GREEN
+	#define PHASE_TIMING_MIN_GREEN			PHASE_TIMING_CONF_MIN_GREEN
+#else
+	#define PHASE_TIMING_MIN_GREEN			(CLOCK_SECOND * 3)
+#endif
+
+#ifdef PHASE_TIMING_CONF_MAX_GREEN
+	#define PHASE_TIMING_MAX_GREEN			PHASE_TIMING_CONF_MAX_GREEN
+#else
+	#define PHASE_TIMING_MAX_GREEN			(CLOCK_SECOND * 20)
+#endif
+
+#ifdef PHASE_TIMING_CONF_EMERGENCY_GREEN
+	#define PHASE_TIMING_EMERGENCY_GREEN	PHASE_TIMING_CONF_EMERGENCY_GREEN
+#else
+	#define PHASE_TIMING_EMERGENCY_GREEN	(CLOCK_SECOND * 5)
+#endif
+
+typedef struct {
+	clock_time_t last_arrival;		// Istante dell'ultimo arrivo
+	unsigned long last_seconds;		// Lo stesso in secondi, per i silenzi lunghi (clock_time() su Sky fa il giro ogni 512 s)
+	clock_time_t interval;			// Media mobile del tempo fra due arrivi, 0 finché non è stimata
+	uint32_t arrival_sum;			// Somma degli istanti di arrivo (s) dei veicoli in coda
+	uint32_t wait_sum;				// Attesa totale (s) dei veicoli serviti
+	uint16_t served;				// Veicoli serviti
+	unsigned long start;			// Inizio delle statistiche (s)
+} phase_timing_t;
+
+void phase_timing_init(phase_timing_t *pt);
+
+// Registra l'arrivo di un veicolo sull'approccio
+void phase_timing_arrival(phase_timing_t *pt);
+
+// Durata del verde per smaltire la coda q
+clock_time_t phase_timing_green(const phase_timing_t *pt, const vehicle_queue_t *q);
+
+// La coda q viene servita adesso: aggiorna le statistiche di attesa
+void phase_timing_served(phase_timing_t *pt, const vehicle_queue_t *q);
+
+// La coda viene svuotata senza servirla: i suoi arrivi escono dalle statistiche di attesa
+void phase_timing_discard(phase_timing_t *pt);
+
+// Ritmo di arrivo recente, veicoli al minuto (0 senza arrivi)
+uint8_t phase_timing_activity(const phase_timing_t *pt);
+
+// Attesa media (s) e veicoli serviti al minuto
+unsigned long phase_timing_avg_wait(const phase_timing_t *pt);
+unsigned long phase_timing_rate(const phase_timing_t *pt);
+
+#endif /* PHASE_TIMING_H_ */
@@ -0,0 +1,83 @@
+#include "sample-batch.h"
+#include <string.h>
+
+#define AT(b, i)		((b)->samples[((b)->head + (i)) % SAMPLE_BATCH_SIZE])
+
+static int fits_int8(int16_t d){
+	return d >= INT8_MIN && d <= INT8_MAX;
+}
+
+void sample_batch_add(sample_batch_t *b, int16_t temperature, int16_t humidity){
+
+	sample_t *sample;
+
+	if(b->count == SAMPLE_BATCH_SIZE){
+		b->head = (b->head + 1) % SAMPLE_BATCH_SIZE;
+		b->epoch++;
+		b->count--;
+	}
+
+	sample = &AT(b, b->count);
+	sample->timestamp = clock_seconds();
+	sample->temperature = temperature;
+	sample->humidity = humidity;
+	b->count++;
+
+}
+
+int sample_batch_due(const sample_batch_t *b){
+	return b->count == SAMPLE_BATCH_SIZE ||
+		(b->count > 0 && (uint16_t)(clock_seconds() - AT(b, 0).timestamp) >= SAMPLE_BATCH_DEADLINE);
+}
+
+uint16_t sample_batch_encode(sample_batch_t *b, its_msg_batch_t *msg){
+
+	its_msg_delta_t delta;
+	const sample_t *prev, *cur;
+	uint16_t dt;
+	uint8_t n;
+
+	if(b->count == 0)
+		return 0;
+
+	prev = &AT(b, 0);
+	its_msg_init(&msg->hdr, ITS_MSG_BATCH);
+	msg->epoch = b->epoch;
+	memcpy(&msg->timestamp, &prev->timestamp, sizeof(prev->timestamp));	// Il messaggio è packed
+	memcpy(&msg->temperature, &prev->temperature, sizeof(prev->temperature));
+	memcpy(&msg->humidity, &prev->humidity, sizeof(prev->humidity));
+
+	for(n = 1; n < b->count; n++){
+		cur = &AT(b, n);
+		dt = cur->timestamp - prev->timestamp;
+		if(dt > UINT8_MAX || !fits_int8(cur->temperature - prev->temperature) || !fits_int8(cur->humidity - prev->humidity))
+			break;		// Le restanti partono nel prossimo batch
+		delta.dt = dt;
+		delta.temperature = cur->temperature - prev->temperature;
+		delta.humidity = cur->humidity - prev->humidity;
+		msg->delta[n - 1] = delta;
+		prev = cur;
+	}
+
+	msg->count = n;
+	b->head = (b->head + n) % SAMPLE_BATCH_SIZE;
+	b->count -= n;
+	b->epoch += n;
+	return its_msg_batch_size(n);
+
+}
+
+void sample_batch_decode(const its_msg_batch_t *msg, uint8_t i, sample_t *sample){
+
+	uint8_t n;
+
+	memcpy(&sample->timestamp, &msg->timestamp, sizeof(sample->timestamp));
+	memcpy(&sample->temperature, &msg->temperature, sizeof(sample->temperature));
+	memcpy(&sample->humidity, &msg->humidity, sizeof(sample->humidity));
+	for(n = 0; n < i; n++){
+		sample->timestamp += msg->delta[n].dt;
+		sample->temperature += msg->delta[n].temperature;
+		sample->humidity += msg->delta[n].humidity;
+	}
+
+}
@@ -0,0 +1,62 @@
+#ifndef SAMPLE_BATCH_H_
+#define SAMPLE_BATCH_H_
+
+#include "contiki.h"
+#include "its-msg.h"
+
+/*
+ * Accumulo delle misure di sensing in un ring buffer e invio di più misure in
+ * un solo ITS_MSG_BATCH, codificate a differenze dalla precedente: l'accensione
+ * della radio e l'overhead del MAC vengono pagati una volta per batch invece che
+ * per misura. Il batch parte quando il buffer è pieno o quando la misura più
+ * vecchia attende da SAMPLE_BATCH_DEADLINE secondi; se l'invio non è possibile
+ * (radio occupata) le nuove misure sovrascrivono le più vecchie.
+ */
+
+// Misure nel ring buffer, al più ITS_MSG_BATCH_MAX per frame
+#ifdef SAMPLE_BATCH_CONF_SIZE
+	#define SAMPLE_BATCH_SIZE		SAMPLE_BATCH_CONF_SIZE
+#else
+	#define SAMPLE_BATCH_SIZE		ITS_MSG_BATCH_MAX
+#endif
+
+// Attesa massima della misura più vecchia prima dell'invio, secondi
+#ifdef SAMPLE_BATCH_CONF_DEADLINE
+	#define SAMPLE_BATCH_DEADLINE	SAMPLE_BATCH_CONF_DEADLINE
+#else
+	#define SAMPLE_BATCH_DEADLINE	30
+#endif
+
+#if SAMPLE_BATCH_SIZE > ITS_MSG_BATCH_MAX
+	#error "SAMPLE_BATCH_SIZE non può superare ITS_MSG_BATCH_MAX"
+#endif
+
+typedef struct {
+	uint16_t timestamp;			// clock_seconds() del campionamento
+	int16_t temperature;
+	int16_t humidity;
+} sample_t;
+
+typedef struct {
+	sample_t samples[SAMPLE_BATCH_SIZE];
+	uint8_t head;				// Misura più vecchia
+	uint8_t count;
+	uint8_t epoch;				// Epoca della misura più vecchia
+} sample_batch_t;
+
+#define sample_batch_empty(b)		((b)->count == 0)
+
+// Accoda una misura, sovrascrivendo la più vecchia a buffer pieno
+void sample_batch_add(sample_batch_t *b, int16_t temperature, int16_t humidity);
+
+// Vero se il batch va inviato: buffer pieno o scadenza della misura più vecchia
+int sample_batch_due(const sample_batch_t *b);
+
+// Codifica in msg le misure più vecchie, finché le differenze entrano nei campi a 8 bit,
+// e le toglie dal buffer; restituisce la lunghezza del frame, 0 se il buffer è vuoto
+uint16_t sample_batch_encode(sample_batch_t *b, its_msg_batch_t *msg);
+
+// Decodifica la misura i-esima di un batch ricevuto (i < count), ricostruendo le differenze
+void sample_batch_decode(const its_msg_batch_t *msg, uint8_t i, sample_t *sample);
+
+#endif /* SAMPLE_BATCH_H_ */
@@ -0,0 +1,62 @@
+#include "sensing-policy.h"
+
+#define EWMA_SHIFT			3		// Peso 1/8 del nuovo campione in media e varianza
+#define VARIANCE_REF		16		// 1 °C²: a questa varianza l'intervallo si dimezza
+#define ACTIVITY_REF		10		// Veicoli al minuto ai quali l'intervallo si dimezza
+
+static clock_time_t threshold_next(const sensing_input_t *in){
+	if(in->level == 0)
+		return 0;
+	if(in->level < 20)
+		return CLOCK_SECOND * 20;
+	if(in->level <= 50)
+		return CLOCK_SECOND * 10;
+	return CLOCK_SECOND * 5;
+}
+
+static clock_time_t proportional_next(const sensing_input_t *in){
+
+	uint32_t interval;
+
+	if(in->level == 0)
+		return 0;
+
+	// Da SENSING_POLICY_MIN a batteria carica fino a SENSING_POLICY_MAX a batteria scarica
+	interval = SENSING_POLICY_MIN + (uint32_t)(SENSING_POLICY_MAX - SENSING_POLICY_MIN) * (100 - in->level) / 100;
+
+	// Misure che cambiano e strada trafficata richiedono campioni più fitti
+	interval = interval * VARIANCE_REF / (VARIANCE_REF + in->variance);
+	interval = interval * ACTIVITY_REF / (ACTIVITY_REF + in->activity);
+
+	if(interval < SENSING_POLICY_MIN)
+		interval = SENSING_POLICY_MIN;
+	return (clock_time_t) interval;
+
+}
+
+const sensing_policy_t sensing_policy_threshold = {"threshold", threshold_next};
+const sensing_policy_t sensing_policy_proportional = {"proportional", proportional_next};
+
+void sensing_stats_add(sensing_stats_t *st, int16_t value){
+
+	int32_t deviation;
+	uint32_t square;
+
+	if(st->samples == 0){
+		st->mean = value * 16;
+		st->variance = 0;
+		st->samples = 1;
+		return;
+	}
+
+	deviation = (int32_t) value * 16 - st->mean;
+	st->mean += deviation / (1 << EWMA_SHIFT);
+
+	square = (uint32_t)(deviation * deviation) >> 4;		// 1/256 °C² -> 1/16 °C²
+	if(square > UINT16_MAX)
+		square = UINT16_MAX;
+	st->variance = st->variance - (st->variance >> EWMA_SHIFT) + (square >> EWMA_SHIFT);
+	if(st->samples < UINT8_MAX)
+		st->samples++;
+
+}
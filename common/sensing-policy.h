@@ -0,0 +1,61 @@
+#ifndef SENSING_POLICY_H_
+#define SENSING_POLICY_H_
+
+#include "contiki.h"
+
+/*
+ * Politica di campionamento: dato lo stato del nodo (carica residua, varianza
+ * recente delle misure, traffico) restituisce l'intervallo fino al prossimo
+ * campione. Le strategie sono funzioni pure, senza accesso a sensori o radio,
+ * quindi si possono provare anche sull'host; si sceglie quella in uso con
+ * SENSING_POLICY_CONF.
+ */
+
+// Limiti dell'intervallo di campionamento
+#ifdef SENSING_POLICY_CONF_MIN
+	#define SENSING_POLICY_MIN		SENSING_POLICY_CONF_MIN
+#else
+	#define SENSING_POLICY_MIN		(CLOCK_SECOND * 5)
+#endif
+
+#ifdef SENSING_POLICY_CONF_MAX
+	#define SENSING_POLICY_MAX		SENSING_POLICY_CONF_MAX
+#else
+	#define SENSING_POLICY_MAX		(CLOCK_SECOND * 60)
+#endif
+
+// Strategia in uso
+#ifdef SENSING_POLICY_CONF
+	#define SENSING_POLICY			SENSING_POLICY_CONF
+#else
+	#define SENSING_POLICY			sensing_policy_threshold
+#endif
+
+typedef struct {
+	uint8_t level;				// Carica residua, %
+	uint16_t variance;			// Varianza recente della temperatura, 1/16 °C²
+	uint8_t activity;			// Veicoli al minuto sulla strada del nodo
+} sensing_input_t;
+
+typedef struct {
+	const char *name;
+	// Intervallo fino al prossimo campione, 0 per sospendere il sensing
+	clock_time_t (* next_interval)(const sensing_input_t *in);
+} sensing_policy_t;
+
+// Soglie fisse sulla carica: 5 s, 10 s sotto il 50 %, 20 s sotto il 20 %, sospeso a 0
+extern const sensing_policy_t sensing_policy_threshold;
+
+// Intervallo proporzionale alla carica consumata, accorciato da varianza e traffico
+extern const sensing_policy_t sensing_policy_proportional;
+
+// Media e varianza mobili delle misure, ingresso delle politiche
+typedef struct {
+	int16_t mean;				// 1/16 °C
+	uint16_t variance;			// 1/16 °C²
+	uint8_t samples;
+} sensing_stats_t;
+
+void sensing_stats_add(sensing_stats_t *st, int16_t value);
+
+#endif /* SENSING_POLICY_H_ */
@@ -0,0 +1,27 @@
+#include "sht11-conv.h"
+
+int16_t sht11_conv_temperature(uint16_t raw){
+	return ((int16_t)(raw / 10) - 396) / 10;
+}
+
+/*
+ * Formula di riferimento (datasheet SHT11, 12 bit, vedi anche
+ * http://tinyos.stanford.edu/tinyos-wiki/index.php/Boomerang_ADC_Example):
+ *   RH_lin  = -4 + 0.0405 * h - 2.8e-6 * h^2
+ *   RH      = (T - 25) * (0.01 + 0.00008 * h) + RH_lin
+ * Moltiplicando tutto per 2500000 i coefficienti diventano interi:
+ *   RH * 2500000 = -10^7 + 101250 * h - 7 * h^2 + 50 * (T - 25) * (500 + 4 * h)
+ * Per h <= 4095 e T in [-40, 125] ogni termine sta in 32 bit con segno, quindi
+ * basta una sola divisione finale (troncata verso zero come il cast da float).
+ */
+int16_t sht11_conv_humidity(uint16_t raw, int16_t temperature){
+
+	int32_t h = raw & 0x0fff;
+	int32_t rh;
+
+	rh = -10000000L + 101250L * h - 7L * h * h;
+	rh += 50L * (temperature - 25) * (500 + 4 * h);
+
+	return rh / 2500000L;
+
+}
@@ -0,0 +1,18 @@
+#ifndef SHT11_CONV_H_
+#define SHT11_CONV_H_
+
+#include <stdint.h>
+
+/*
+ * Conversione delle letture grezze di sht11_sensor in °C e % RH, solo in
+ * aritmetica intera: l'MSP430 dello Sky non ha FPU e le formule in virgola
+ * mobile si portavano dietro l'emulazione software.
+ */
+
+// Temperatura in °C da SHT11_SENSOR_TEMP
+int16_t sht11_conv_temperature(uint16_t raw);
+
+// Umidità relativa in %, compensata con la temperatura (°C), da SHT11_SENSOR_HUMIDITY
+int16_t sht11_conv_humidity(uint16_t raw, int16_t temperature);
+
+#endif /* SHT11_CONV_H_ */
@@ -0,0 +1,173 @@
+#include "sink-table.h"
+#include <string.h>
+
+// Slot della hash table: potenza di 2 almeno doppia dei nodi, per tenere corte le scansioni
+#define SLOTS		(SINK_TABLE_SIZE <= 8 ? 16 : SINK_TABLE_SIZE <= 32 ? 64 : SINK_TABLE_SIZE <= 64 ? 128 : 256)
+#define EMPTY		0xff
+
+#define IS_REPORTED(i)		(reported[(i) >> 3] & (1 << ((i) & 7)))
+#define SET_REPORTED(i)		(reported[(i) >> 3] |= 1 << ((i) & 7))
+#define CLEAR_REPORTED(i)	(reported[(i) >> 3] &= ~(1 << ((i) & 7)))
+
+static sink_node_t nodes[SINK_TABLE_SIZE];				// Entry dense, indici 0..count-1
+static uint8_t slots[SLOTS];							// Hash table: indice in nodes[] o EMPTY
+static uint8_t reported[(SINK_TABLE_SIZE + 7) / 8];		// Bitmap dei nodi che hanno riportato nella finestra
+static uint8_t count = 0, reported_count = 0;
+static struct ctimer window_timer;						// Scadenza della finestra aperta
+static uint8_t window_open = 0;
+static void (* window_closed)(void);
+
+static uint8_t hash(const linkaddr_t *addr){
+	return (addr->u8[0] ^ (addr->u8[1] * 31)) & (SLOTS - 1);
+}
+
+// Slot che contiene il nodo, oppure il primo slot libero della sua sequenza di scansione
+static uint8_t find_slot(const linkaddr_t *addr){
+
+	uint8_t slot = hash(addr);
+
+	while(slots[slot] != EMPTY && !linkaddr_cmp(&nodes[slots[slot]].addr, addr))
+		slot = (slot + 1) & (SLOTS - 1);
+	return slot;
+
+}
+
+// Rimuove il nodo in posizione index: l'ultima entry prende il suo posto in nodes[],
+// e gli slot successivi della stessa scansione vengono compattati all'indietro
+static void remove_node(uint8_t index){
+
+	uint8_t slot = find_slot(&nodes[index].addr);
+	uint8_t next, home;
+
+	count--;
+	if(index != count){
+		// Slot dell'ultima entry cercato prima di spostarla: dopo la copia lo slot del nodo
+		// rimosso, ancora occupato da index, potrebbe fermare la scansione al posto suo
+		slots[find_slot(&nodes[count].addr)] = index;
+		nodes[index] = nodes[count];
+		if(IS_REPORTED(count))
+			SET_REPORTED(index);
+		else
+			CLEAR_REPORTED(index);
+	}
+	CLEAR_REPORTED(count);
+
+	slots[slot] = EMPTY;
+	for(next = (slot + 1) & (SLOTS - 1); slots[next] != EMPTY; next = (next + 1) & (SLOTS - 1)){
+		home = hash(&nodes[slots[next]].addr);
+		// L'entry scala nello slot liberato se questo sta tra la sua posizione ideale e next
+		if(((next - home) & (SLOTS - 1)) >= ((next - slot) & (SLOTS - 1))){
+			slots[slot] = slots[next];
+			slots[next] = EMPTY;
+			slot = next;
+		}
+	}
+
+}
+
+static void close_window(void *ptr){
+
+	uint8_t index;
+
+	ctimer_stop(&window_timer);
+	window_open = 0;
+	if(window_closed != NULL)
+		window_closed();
+
+	// Invecchia i nodi che non hanno riportato, scorrendo all'indietro perché remove_node sposta l'ultima entry
+	for(index = count; index-- > 0;){
+		if(IS_REPORTED(index))
+			nodes[index].missed = 0;
+#if SINK_TABLE_HOLD
+		else if(clock_seconds() - nodes[index].heard > SINK_TABLE_HOLD)
+#else
+		else if(++nodes[index].missed >= SINK_TABLE_MAX_MISSED)
+#endif
+			remove_node(index);
+	}
+
+	memset(reported, 0, sizeof(reported));
+	reported_count = 0;
+
+}
+
+void sink_table_init(void (* callback)(void)){
+	memset(slots, EMPTY, sizeof(slots));
+	memset(reported, 0, sizeof(reported));
+	count = 0;
+	reported_count = 0;
+	window_open = 0;
+	window_closed = callback;
+}
+
+sink_node_t *sink_table_lookup(const linkaddr_t *addr){
+	uint8_t slot = find_slot(addr);
+	return slots[slot] == EMPTY ? NULL : &nodes[slots[slot]];
+}
+
+int sink_table_report(const linkaddr_t *addr, uint8_t epoch, int16_t temperature, int16_t humidity){
+
+	uint8_t slot = find_slot(addr);
+	uint8_t index;
+
+	if(slots[slot] == EMPTY){
+		if(count == SINK_TABLE_SIZE)
+			return SINK_TABLE_FULL;
+		slots[slot] = count;
+		linkaddr_copy(&nodes[count].addr, addr);
+		nodes[count].missed = 0;
+		nodes[count].epoch = epoch - 1;
+		count++;
+	}
+
+	index = slots[slot];
+	if((int8_t)(epoch - nodes[index].epoch) <= 0)
+		return SINK_TABLE_STALE;
+
+	if(!window_open){
+		window_open = 1;
+		ctimer_set(&window_timer, SINK_TABLE_WINDOW, close_window, NULL);
+	}
+
+	nodes[index].epoch = epoch;
+	nodes[index].temperature = temperature;
+	nodes[index].humidity = humidity;
+	nodes[index].heard = clock_seconds();
+	if(!IS_REPORTED(index)){
+		SET_REPORTED(index);
+		reported_count++;
+	}
+
+	if(sink_table_complete())
+		close_window(NULL);
+	return index;
+
+}
+
+uint8_t sink_table_count(void){
+	return count;
+}
+
+uint8_t sink_table_reported(void){
+	return reported_count;
+}
+
+int sink_table_complete(void){
+	return count >= SINK_TABLE_EXPECTED && reported_count == count;
+}
+
+uint8_t sink_table_sum(int32_t *temperature, int32_t *humidity){
+
+	uint8_t index;
+
+	*temperature = 0;
+	*humidity = 0;
+	for(index = 0; index < count; index++){
+		if(SINK_TABLE_HOLD || IS_REPORTED(index)){
+			*temperature += nodes[index].temperature;
+			*humidity += nodes[index].humidity;
+		}
+	}
+	return SINK_TABLE_HOLD ? count : reported_count;
+
+}
@@ -0,0 +1,96 @@
+#ifndef SINK_TABLE_H_
+#define SINK_TABLE_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/*
+ * Tabella di aggregazione del sink (G1): un'entry per ogni nodo che invia
+ * misure, indicizzata per indirizzo Rime con una hash table ad indirizzamento
+ * aperto, più una bitmap dei nodi che hanno già riportato nella finestra corrente.
+ * Il costo per pacchetto ricevuto è costante qualunque sia il numero di nodi.
+ *
+ * Le misure sono aggregate per finestre: la prima misura dopo una chiusura apre
+ * una finestra, che si chiude quando hanno riportato tutti i nodi registrati
+ * oppure allo scadere di SINK_TABLE_WINDOW. Un nodo silenzioso quindi ritarda
+ * la media al più di una finestra, e dopo SINK_TABLE_MAX_MISSED finestre senza
+ * misure viene rimosso dalla tabella.
+ *
+ * Se i nodi inviano solo su variazione (deadband.h) va impostato SINK_TABLE_HOLD:
+ * un nodo che non riporta ha la misura invariata, quindi la sua ultima misura
+ * resta nella media e il nodo viene rimosso solo dopo SINK_TABLE_HOLD secondi
+ * di silenzio, più di un heartbeat.
+ */
+
+// Numero massimo di nodi aggregati, fissato a compile time: al più 128, perché indici e
+// numero di nodi sono uint8_t (0xff marca lo slot vuoto) e gli slot, almeno il doppio dei nodi, sono al più 256
+#ifdef SINK_TABLE_CONF_SIZE
+	#define SINK_TABLE_SIZE			SINK_TABLE_CONF_SIZE
+#else
+	#define SINK_TABLE_SIZE			16
+#endif
+
+#if SINK_TABLE_SIZE > 128
+	#error "SINK_TABLE_SIZE deve essere al più 128"
+#endif
+
+// Nodi attesi prima di chiudere una finestra senza aspettare la scadenza (G2, TL1, TL2)
+#ifdef SINK_TABLE_CONF_EXPECTED
+	#define SINK_TABLE_EXPECTED		SINK_TABLE_CONF_EXPECTED
+#else
+	#define SINK_TABLE_EXPECTED		3
+#endif
+
+// Durata massima di una finestra di aggregazione
+#ifdef SINK_TABLE_CONF_WINDOW
+	#define SINK_TABLE_WINDOW		SINK_TABLE_CONF_WINDOW
+#else
+	#define SINK_TABLE_WINDOW		(CLOCK_SECOND * 7)
+#endif
+
+// Finestre consecutive senza misure dopo le quali un nodo viene rimosso
+#ifdef SINK_TABLE_CONF_MAX_MISSED
+	#define SINK_TABLE_MAX_MISSED	SINK_TABLE_CONF_MAX_MISSED
+#else
+	#define SINK_TABLE_MAX_MISSED	3
+#endif
+
+// Secondi per cui l'ultima misura di un nodo silenzioso resta valida, 0 per usare solo la finestra corrente
+#ifdef SINK_TABLE_CONF_HOLD
+	#define SINK_TABLE_HOLD			SINK_TABLE_CONF_HOLD
+#else
+	#define SINK_TABLE_HOLD			0
+#endif
+
+#define SINK_TABLE_FULL			-1		// Nessuno spazio per un nuovo nodo
+#define SINK_TABLE_STALE		-2		// Epoca già vista o precedente all'ultima ricevuta
+
+typedef struct {
+	linkaddr_t addr;
+	uint8_t epoch;				// Ultima epoca di campionamento ricevuta
+	uint8_t missed;				// Finestre consecutive senza misure
+	unsigned long heard;		// clock_seconds() dell'ultima misura
+	int16_t temperature;
+	int16_t humidity;
+} sink_node_t;
+
+// window_closed viene chiamata alla chiusura di ogni finestra, prima di azzerarla
+void sink_table_init(void (* window_closed)(void));
+
+// Entry del nodo, NULL se il nodo non è in tabella
+sink_node_t *sink_table_lookup(const linkaddr_t *addr);
+
+// Registra la misura del nodo nella finestra corrente; SINK_TABLE_FULL o SINK_TABLE_STALE se scartata
+int sink_table_report(const linkaddr_t *addr, uint8_t epoch, int16_t temperature, int16_t humidity);
+
+// Nodi registrati e nodi che hanno riportato nella finestra corrente
+uint8_t sink_table_count(void);
+uint8_t sink_table_reported(void);
+
+// Vero quando tutti i nodi registrati (almeno SINK_TABLE_EXPECTED) hanno riportato
+int sink_table_complete(void);
+
+// Somma le misure della finestra corrente (con SINK_TABLE_HOLD l'ultima di ogni nodo); restituisce il numero di nodi sommati
+uint8_t sink_table_sum(int32_t *temperature, int32_t *humidity);
+
+#endif /* SINK_TABLE_H_ */
@@ -0,0 +1,144 @@
+#include "tx-queue.h"
+#include "its-log.h"
+#include "link-stats.h"
+#include "energy-acct.h"
+#include <string.h>
+
+static tx_queue_entry_t queue[TX_QUEUE_SIZE];	// Ordinata per classe, FIFO nella classe
+static uint8_t count = 0;
+static struct runicast_conn *conn;
+
+PROCESS(tx_queue_process, "TX queue");
+
+#define TYPE(e)		(((const its_msg_hdr_t *) (e)->data)->version_type & 0x0f)
+
+static void drop(const tx_queue_entry_t *e){
+	ITS_LOG_ERR(RADIO, TX_DROPPED, TYPE(e), e->class);
+}
+
+void tx_queue_open(struct runicast_conn *c){
+	conn = c;
+	count = 0;
+	process_start(&tx_queue_process, NULL);
+}
+
+int tx_queue_push(uint8_t class, const linkaddr_t *to, const void *data, uint8_t len){
+
+	tx_queue_entry_t entry;
+	uint8_t i;
+
+	if(len > TX_QUEUE_PAYLOAD)
+		return 0;
+	linkaddr_copy(&entry.to, to);
+	entry.class = class;
+	entry.len = len;
+	memcpy(entry.data, data, len);
+
+	if(count == TX_QUEUE_SIZE){
+		if(queue[count - 1].class <= class){
+			drop(&entry);
+			return 0;
+		}
+		drop(&queue[--count]);		// L'ultimo è il più recente della classe più bassa
+	}
+
+	// Dopo tutti i messaggi della stessa classe o più urgenti
+	for(i = count; i > 0 && queue[i - 1].class > class; i--)
+		queue[i] = queue[i - 1];
+	queue[i] = entry;
+	count++;
+
+	process_poll(&tx_queue_process);
+	return 1;
+
+}
+
+uint8_t tx_queue_pending(uint8_t class){
+
+	uint8_t i, n = 0;
+
+	for(i = 0; i < count; i++)
+		if(queue[i].class == class)
+			n++;
+	return n;
+
+}
+
+uint8_t tx_queue_cancel(uint8_t type, const linkaddr_t *to){
+
+	uint8_t i, kept = 0;
+
+	for(i = 0; i < count; i++){
+		if(TYPE(&queue[i]) == type && linkaddr_cmp(&queue[i].to, to))
+			continue;
+		if(kept != i)
+			queue[kept] = queue[i];
+		kept++;
+	}
+	i = count - kept;
+	count = kept;
+	return i;
+
+}
+
+void tx_queue_done(const linkaddr_t *to, uint8_t retransmissions, int acked){
+	link_stats_tx(to, retransmissions, acked);
+	energy_acct_txpower(LINK_STATS_POWER_MAX);		// I broadcast restano alla potenza di default
+	process_poll(&tx_queue_process);
+}
+
+// Ritrasmissioni per classe e qualità del collegamento
+static uint8_t budget(const tx_queue_entry_t *e){
+
+	const link_stats_t *l = link_stats_lookup(&e->to);
+	uint8_t prr = l != NULL ? l->prr : 100;
+
+	switch(e->class){
+		case TX_QUEUE_EMERGENCY:
+		case TX_QUEUE_CONTROL:
+			return prr < LINK_STATS_POOR ? TX_QUEUE_POOR_RETX : TX_QUEUE_RETX;
+		case TX_QUEUE_TELEMETRY:
+			// Almeno una ritrasmissione: con 0 runicast dichiara il timeout prima che
+			// arrivi l'ACK e il collegamento non potrebbe più risalire sopra POOR
+			return prr >= LINK_STATS_GOOD || prr < LINK_STATS_POOR ? 1 : TX_QUEUE_TELEMETRY_RETX;
+		default:
+			return TX_QUEUE_RETX;
+	}
+
+}
+
+PROCESS_THREAD(tx_queue_process, ev, data){
+
+	static struct etimer pace;		// Attesa della telemetria dopo un timeout
+	clock_time_t wait;
+	uint8_t power;
+
+	PROCESS_BEGIN();
+
+	while(1){
+
+		PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL || (ev == PROCESS_EVENT_TIMER && data == &pace));
+
+		if(count == 0 || runicast_is_transmitting(conn))
+			continue;
+
+		// In testa c'è la telemetria solo se non ci sono classi più urgenti
+		if(queue[0].class == TX_QUEUE_TELEMETRY && (wait = link_stats_backoff(&queue[0].to)) > 0){
+			etimer_set(&pace, wait);
+			continue;
+		}
+
+		// Potenza del collegamento per tutti i tentativi: runicast ritrasmette gli attributi del pacchetto
+		packetbuf_copyfrom(queue[0].data, queue[0].len);
+		power = link_stats_power(&queue[0].to);
+		packetbuf_set_attr(PACKETBUF_ATTR_RADIO_TXPOWER, power + 1);		// 0 è la potenza di default della radio
+		energy_acct_txpower(power);
+		runicast_send(conn, &queue[0].to, budget(&queue[0]));
+		count--;
+		memmove(&queue[0], &queue[1], count * sizeof(queue[0]));
+
+	}
+
+	PROCESS_END();
+
+}
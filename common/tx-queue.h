@@ -0,0 +1,86 @@
+#ifndef TX_QUEUE_H_
+#define TX_QUEUE_H_
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "its-msg.h"
+
+/*
+ * Coda dei messaggi in uscita sull'unica connessione runicast del nodo.
+ *
+ * Al posto di scartare un invio quando runicast è occupato, il messaggio viene
+ * copiato in coda con la sua classe di priorità; tx_queue_process trasmette il
+ * primo messaggio della classe più alta appena runicast si libera (callback
+ * sent/timedout -> tx_queue_done). Dentro una classe l'ordine è FIFO. Con la
+ * coda piena un messaggio scavalca l'ultimo di una classe inferiore, che viene
+ * scartato; altrimenti è il nuovo a essere scartato (evento TX_DROPPED).
+ *
+ * Le ritrasmissioni di ogni invio dipendono dalla classe e dal PRR del
+ * collegamento (link-stats.h). La telemetria usa meno ritrasmissioni
+ * (TX_QUEUE_TELEMETRY_RETX, una sola su un collegamento buono o scarso): un report in volo occupa runicast al più per quei tentativi prima
+ * che passi il controllo. Emergenze e handshake su un collegamento scarso
+ * salgono a TX_QUEUE_POOR_RETX. Dopo un timeout la telemetria verso quel vicino
+ * attende link_stats_backoff(), mentre le classi più urgenti passano subito.
+ * Ogni invio usa la potenza scelta per il vicino da link_stats_power().
+ */
+
+// Classi, dalla più urgente
+#define TX_QUEUE_EMERGENCY			0		// Veicolo di emergenza
+#define TX_QUEUE_CONTROL			1		// Handshake tra semafori
+#define TX_QUEUE_NOTIFY				2		// Notifica di un veicolo
+#define TX_QUEUE_TELEMETRY			3		// Misure e report
+
+#ifdef TX_QUEUE_CONF_SIZE
+	#define TX_QUEUE_SIZE			TX_QUEUE_CONF_SIZE
+#else
+	#define TX_QUEUE_SIZE			4
+#endif
+
+// Ritrasmissioni runicast per le classi di controllo, anche su un collegamento scarso, e per la telemetria
+#ifdef TX_QUEUE_CONF_RETX
+	#define TX_QUEUE_RETX			TX_QUEUE_CONF_RETX
+#else
+	#define TX_QUEUE_RETX			5
+#endif
+
+#ifdef TX_QUEUE_CONF_POOR_RETX
+	#define TX_QUEUE_POOR_RETX		TX_QUEUE_CONF_POOR_RETX
+#else
+	#define TX_QUEUE_POOR_RETX		8
+#endif
+
+#ifdef TX_QUEUE_CONF_TELEMETRY_RETX
+	#define TX_QUEUE_TELEMETRY_RETX	TX_QUEUE_CONF_TELEMETRY_RETX
+#else
+	#define TX_QUEUE_TELEMETRY_RETX	2
+#endif
+
+// Il messaggio ITS più lungo è il batch di misure
+#define TX_QUEUE_PAYLOAD			sizeof(its_msg_batch_t)
+
+typedef struct {
+	linkaddr_t to;
+	uint8_t class;
+	uint8_t len;
+	uint8_t data[TX_QUEUE_PAYLOAD];
+} tx_queue_entry_t;
+
+PROCESS_NAME(tx_queue_process);
+
+// Collega la coda alla connessione runicast già aperta
+void tx_queue_open(struct runicast_conn *c);
+
+// Copia il messaggio in coda; 0 se è stato scartato
+int tx_queue_push(uint8_t class, const linkaddr_t *to, const void *data, uint8_t len);
+
+// Toglie dalla coda i messaggi ITS del tipo indicato verso to, prima di accodarne uno più
+// aggiornato; restituisce quanti ne ha tolti (quello in volo resta)
+uint8_t tx_queue_cancel(uint8_t type, const linkaddr_t *to);
+
+// Messaggi della classe in attesa (escluso quello in volo)
+uint8_t tx_queue_pending(uint8_t class);
+
+// Da chiamare nelle callback sent (acked 1) e timedout (acked 0) di runicast
+void tx_queue_done(const linkaddr_t *to, uint8_t retransmissions, int acked);
+
+#endif /* TX_QUEUE_H_ */
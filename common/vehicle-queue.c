@@ -0,0 +1,76 @@
+#include "vehicle-queue.h"
+
+void vehicle_queue_push(vehicle_queue_t *q, uint8_t vehicle){
+	if(vehicle == VEHICLE_QUEUE_EMERGENCY && q->emergency < UINT8_MAX)
+		q->emergency++;
+	else if(vehicle == VEHICLE_QUEUE_NORMAL && q->normal < UINT8_MAX)
+		q->normal++;
+}
+
+void vehicle_queue_upgrade(vehicle_queue_t *q){
+	if(q->normal == 0)
+		return;
+	q->normal--;
+	vehicle_queue_push(q, VEHICLE_QUEUE_EMERGENCY);
+}
+
+uint8_t vehicle_queue_reconcile(vehicle_queue_t *q, vehicle_count_t *last,
+	uint16_t normal, uint16_t emergency, uint8_t boot, uint8_t vehicle){
+
+	int16_t dn, de;
+	uint16_t dt;
+	uint8_t arrivals = 0;
+
+	if(last->valid){
+		dt = (uint16_t)(normal + emergency) - (uint16_t)(last->normal + last->emergency);
+		if(boot != last->boot)		// Nuovo avvio: il G* è ripartito da zero
+			last->valid = 0;
+		else if(dt >= 0x8000)
+			return 0;		// Totale precedente all'ultimo visto: report in ritardo
+		else if(dt == 0 && (int16_t)(emergency - last->emergency) <= 0)
+			return 0;		// Nessun veicolo né upgrade nuovo: duplicato
+	}
+
+	if(!last->valid){
+		last->normal = normal - (vehicle == VEHICLE_QUEUE_NORMAL);
+		last->emergency = emergency - (vehicle == VEHICLE_QUEUE_EMERGENCY);
+		last->boot = boot;
+		last->valid = 1;
+	}
+
+	dn = normal - last->normal;
+	de = emergency - last->emergency;
+	last->normal = normal;
+	last->emergency = emergency;
+
+	// Un'emergenza nuova è l'upgrade di un normale già contato (dn negativo) oppure un arrivo
+	for(; de > 0 && arrivals < UINT8_MAX; de--){
+		if(dn < 0){
+			vehicle_queue_upgrade(q);
+			dn++;
+		}else{
+			vehicle_queue_push(q, VEHICLE_QUEUE_EMERGENCY);
+			arrivals++;
+		}
+	}
+	for(; dn > 0 && arrivals < UINT8_MAX; dn--){
+		vehicle_queue_push(q, VEHICLE_QUEUE_NORMAL);
+		arrivals++;
+	}
+
+	return arrivals;
+
+}
+
+void vehicle_queue_clear(vehicle_queue_t *q){
+	q->normal = 0;
+	q->emergency = 0;
+}
+
+uint8_t vehicle_queue_top(const vehicle_queue_t *q){
+	if(q->emergency != 0)
+		return VEHICLE_QUEUE_EMERGENCY;
+	if(q->normal != 0)
+		return VEHICLE_QUEUE_NORMAL;
+	return VEHICLE_QUEUE_NONE;
+}
@@ -0,0 +1,62 @@
+#ifndef VEHICLE_QUEUE_H_
+#define VEHICLE_QUEUE_H_
+
+#include <stdint.h>
+
+/*
+ * Coda dei veicoli in attesa su un approccio, divisa per classe. Bastano due
+ * contatori: i veicoli della stessa classe sono indistinguibili e il verde
+ * scarica l'intera coda in una sola fase.
+ */
+
+#define VEHICLE_QUEUE_NONE			0	// Stessi valori di vehicle_t: NONE, NORMAL, EMERGENCY
+#define VEHICLE_QUEUE_NORMAL		1
+#define VEHICLE_QUEUE_EMERGENCY		2
+
+typedef struct {
+	uint8_t normal;
+	uint8_t emergency;
+} vehicle_queue_t;
+
+// Ultimo report cumulativo visto da un G* (its_msg_count_t)
+typedef struct {
+	uint16_t normal;
+	uint16_t emergency;
+	uint8_t boot;
+	uint8_t valid;
+} vehicle_count_t;
+
+#define vehicle_queue_empty(q)		((q)->normal == 0 && (q)->emergency == 0)
+#define vehicle_queue_length(q)		((uint16_t)(q)->normal + (q)->emergency)
+
+// Accoda un veicolo della classe indicata (i contatori saturano a 255)
+void vehicle_queue_push(vehicle_queue_t *q, uint8_t vehicle);
+
+// Promuove a emergenza un veicolo normale in coda; senza veicoli normali il veicolo è già
+// passato e l'upgrade viene ignorato (una notifica persa arriva come emergenza nuova dai
+// conteggi di vehicle_queue_reconcile)
+void vehicle_queue_upgrade(vehicle_queue_t *q);
+
+/*
+ * Aggiorna la coda con un report cumulativo di un G* (veicoli per classe dal suo
+ * avvio): accoda i veicoli non ancora visti, anche quelli di report persi, e
+ * applica gli upgrade a emergenza. L'ordine dei report viene dai conteggi stessi:
+ * ogni veicolo nuovo fa crescere il totale e ogni upgrade, a totale invariato,
+ * le emergenze. Il seqno dell'header non serve, perché avanza anche con misure
+ * ed energia e su una strada ferma fa il giro. I totali sono confrontati in
+ * aritmetica modulare, quindi valgono anche oltre 32767 veicoli: un report che
+ * non fa avanzare i conteggi è un duplicato, o uno arrivato in ritardo, e non
+ * cambia nulla. Il riavvio del G* si riconosce da boot diverso e riparte da capo;
+ * al primo report (o dopo un riavvio) conta solo il veicolo della classe vehicle
+ * appena segnalato. Ritorna i nuovi arrivi.
+ */
+uint8_t vehicle_queue_reconcile(vehicle_queue_t *q, vehicle_count_t *last,
+	uint16_t normal, uint16_t emergency, uint8_t boot, uint8_t vehicle);
+
+// Svuota la coda
+void vehicle_queue_clear(vehicle_queue_t *q);
+
+// Classe più urgente presente in coda, VEHICLE_QUEUE_NONE se vuota
+uint8_t vehicle_queue_top(const vehicle_queue_t *q);
+
+#endif /* VEHICLE_QUEUE_H_ */
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+#
+# Decodifica dei record binari del log dei nodi (common/its-log.h).
+#
+# Legge da file o stdin e riscrive ogni riga sostituendo il record "@L<hex>"
+# con il testo dell'evento, preso da common/its-log-events.h; il resto della
+# riga (es. il prefisso "<ms> <nodo> " di bench/run.sh) e le righe senza
+# record restano invariati.
+#
+# Uso: ./log-decode.py [-t] [-l livello] [--hz tick_al_secondo] [file...]
+#  -t		antepone il tempo del nodo in secondi e "[MODULO LIVELLO]"
+#  -l		scarta i record sopra il livello (ERR, INFO, DBG)
+#  --hz		CLOCK_SECOND del nodo (default 128, Sky)
+
+import argparse
+import fileinput
+import os
+import re
+import sys
+
+EVENTS = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'common', 'its-log-events.h')
+MODULES = ['LOG', 'TRAFFIC', 'RADIO']
+LEVELS = ['NONE', 'ERR', 'INFO', 'DBG']
+RECORD = re.compile(r'@L([0-9a-fA-F]{20})')
+
+
+def load_formats(path):
+	formats = []
+	with open(path) as f:
+		for name, fmt in re.findall(r'^ITS_LOG_EVENT\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"\s*\)', f.read(), re.M):
+			formats.append((name, fmt.encode().decode('unicode_escape')))
+	return formats
+
+
+def decode(hexrec, formats, args):
+	time, event, level = int(hexrec[0:4], 16), int(hexrec[4:6], 16), int(hexrec[6:8], 16)
+	values = [int(hexrec[i:i + 4], 16) for i in (8, 12, 16)]
+	if event >= len(formats):
+		return 'LOG: evento sconosciuto %d' % event
+	if args.level is not None and (level & 0x0f) > args.level:
+		return None
+	fmt = formats[event][1]
+	text = fmt % tuple(values[:fmt.count('%u')])
+	if args.time:
+		module = MODULES[level >> 4] if (level >> 4) < len(MODULES) else str(level >> 4)
+		text = '%.3f [%s %s] %s' % (time / args.hz, module, LEVELS[level & 0x03], text)
+	return text
+
+
+def main():
+	parser = argparse.ArgumentParser()
+	parser.add_argument('-t', dest='time', action='store_true')
+	parser.add_argument('-l', dest='level', choices=LEVELS[1:])
+	parser.add_argument('--hz', type=float, default=128)
+	parser.add_argument('files', nargs='*')
+	args = parser.parse_args()
+	if args.level is not None:
+		args.level = LEVELS.index(args.level)
+
+	formats = load_formats(EVENTS)
+	for line in fileinput.input(args.files):
+		match = RECORD.search(line)
+		if match is None:
+			sys.stdout.write(line)
+		else:
+			text = decode(match.group(1), formats, args)
+			if text is not None:
+				sys.stdout.write(line[:match.start()] + text + '\n')
+		sys.stdout.flush()		# Anche in pipe dalla seriale
+
+
+if __name__ == '__main__':
+	main()
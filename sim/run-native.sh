@@ -0,0 +1,83 @@
+#!/bin/bash
+#
+# Simulazione su target native: compila G1, G2 e TL per "native" e avvia
+# N intersezioni indipendenti (4 processi ciascuna: G1, G2, TL1, TL2).
+# Ogni intersezione usa una porta UDP diversa, quindi i nodi di intersezioni
+# diverse non si sentono tra loro.
+#
+# Uso: ./run-native.sh <Broadcast|Unicast> [intersezioni] [durata_s]
+#
+# Variabili d'ambiente (passate ai nodi):
+#  ITS_SIM_ARRIVAL_MS	tempo medio tra due veicoli per ogni G* (default 8000)
+#  ITS_SIM_EMERGENCY	percentuale di veicoli di emergenza (default 10)
+#  ITS_SIM_LOSS			percentuale di frame persi (default 0)
+#  ITS_SIM_BASE_PORT	porta della prima intersezione (default 7000)
+#  ITS_SIM_NEAR_POWER	PA_LEVEL minimo tra G* e il suo semaforo e tra i semafori (default 7)
+#  ITS_SIM_FAR_POWER	PA_LEVEL minimo sugli altri collegamenti (default 19)
+
+TREE=${1:?Uso: $0 <Broadcast|Unicast> [intersezioni] [durata_s]}
+COUNT=${2:-1}
+DURATION=${3:-60}
+BASE_PORT=${ITS_SIM_BASE_PORT:-7000}
+SIM_DIR=$(cd "$(dirname "$0")" && pwd)
+ROOT=$(cd "$SIM_DIR/.." && pwd)
+OUT=$SIM_DIR/out/$TREE
+
+export ITS_SIM_EMERGENCY=${ITS_SIM_EMERGENCY:-10}
+export ITS_SIM_LOSS=${ITS_SIM_LOSS:-0}
+ARRIVAL=${ITS_SIM_ARRIVAL_MS:-8000}
+
+for role in G1 G2 TL; do
+	make -C "$ROOT/$TREE/$role" -j5 TARGET=native > /dev/null || exit 1
+done
+
+rm -rf "$OUT"
+mkdir -p "$OUT"
+PIDS=()
+
+# Avvia un nodo: <intersezione> <ruolo> <indirizzo> <nome> <arrivi_ms>
+start_node(){
+	# stdin aperto ma vuoto: la serial line del target native legge da stdin
+	sleep $((DURATION + 5)) | ITS_SIM_PORT=$((BASE_PORT + $1)) ITS_NODE=$3 ITS_SIM_ARRIVAL_MS=$5 \
+		"$ROOT/$TREE/$2/$2.native" > "$OUT/$1/$4.log" 2>&1 &
+	PIDS+=($!)
+}
+
+for ((i = 0; i < COUNT; i++)); do
+	mkdir -p "$OUT/$i"
+	start_node $i TL 3 TL1 0
+	start_node $i TL 4 TL2 0
+	start_node $i G1 1 G1 $ARRIVAL
+	start_node $i G2 2 G2 $ARRIVAL
+done
+
+echo "$TREE: $COUNT intersezioni ($((COUNT * 4)) nodi) per ${DURATION}s, log in $OUT"
+sleep "$DURATION"
+kill "${PIDS[@]}" 2> /dev/null
+wait 2> /dev/null
+
+arrivals=$(cat "$OUT"/*/G*.log | grep -c "^SIM: arrival")
+greens=$(cat "$OUT"/*/TL*.log | grep -c "STATO: GREEN_TL")
+echo "Veicoli arrivati: $arrivals"
+served=$(cat "$OUT"/*/TL*.log | awk -F'VEICOLI: ' '/STATO: GREEN_TL/ { n += $2 } END { print n + 0 }')
+echo "Fasi verdi: $greens"
+echo "Veicoli serviti: $served"
+
+# Ultima riga TRAFFICO di ogni semaforo: attesa media pesata sui veicoli serviti
+for log in "$OUT"/*/TL*.log; do
+	grep "^TRAFFICO:" "$log" | tail -n 1
+done | awk -v duration="$DURATION" '{
+	n += $3; wait += $3 * $6
+} END {
+	printf "Attesa media: %.1f s\n", n ? wait / n : 0
+	printf "Veicoli al minuto: %.1f\n", n * 60 / duration
+}'
+
+# Ultimo report ENERGY di ogni nodo stampato da G1: carica del periodo sommata su tutti i nodi
+for log in "$OUT"/*/G1.log; do
+	grep "^ENERGY:" "$log" | awk '{ last[$2] = $0 } END { for(n in last) print last[n] }'
+done | awk '{
+	for(i = 1; i < NF; i++) if($i ~ /^(IDLE|BLINK|TRAFFIC|GREEN|SENSING|NOTIFY)$/) mc += $(i + 1)
+} END {
+	printf "Carica ultimo periodo (tutti i nodi): %u mC\n", mc
+}'
@@ -0,0 +1,129 @@
+/*
+ * Test su host delle politiche di campionamento di common/sensing-policy.c:
+ * le strategie sono funzioni pure, quindi vengono pilotate con sequenze
+ * sintetiche di carica, misure e traffico e ne vengono controllati gli
+ * intervalli scelti.
+ *
+ * Compilazione ed esecuzione dalla cartella sim/, con gli header di Contiki per
+ * native (CLOCK_SECOND e clock_time_t):
+ *   gcc -O2 -I../common -I$CONTIKI/core -I$CONTIKI/cpu/native -I$CONTIKI/platform/native \
+ *     -o sensing-policy-test sensing-policy-test.c ../common/sensing-policy.c
+ *   ./sensing-policy-test
+ *
+ * Controlli:
+ *  - threshold: 5 s sopra il 50 %, 10 s fino al 20 %, 20 s sotto, sospeso a 0;
+ *  - proportional: da SENSING_POLICY_MIN a batteria carica verso SENSING_POLICY_MAX
+ *    a batteria scarica, mai più corto di SENSING_POLICY_MIN, dimezzato da una
+ *    varianza di 1 °C² e da 10 veicoli al minuto, sospeso a 0;
+ *  - entrambe: l'intervallo non si accorcia mentre la carica scende;
+ *  - sensing_stats_add: varianza nulla su misure costanti, che cresce con misure
+ *    che oscillano e accorcia l'intervallo di proportional.
+ * Alla fine stampa i campioni che ogni politica prenderebbe su una scarica
+ * completa con temperatura e traffico sintetici. Esce con errore al primo
+ * controllo fallito.
+ */
+
+#include "sensing-policy.h"
+
+#include <stdio.h>
+
+#define CHECK(cond, ...)	do { if(!(cond)){ printf("ERRORE: " __VA_ARGS__); printf("\n"); return 1; } } while(0)
+
+static clock_time_t next(const sensing_policy_t *p, uint8_t level, uint16_t variance, uint8_t activity){
+	sensing_input_t in = {level, variance, activity};
+	return p->next_interval(&in);
+}
+
+// Campioni presi da una politica su una scarica lineare, un punto di carica ogni 10 minuti
+static unsigned long discharge(const sensing_policy_t *p){
+
+	sensing_stats_t stats = {0, 0, 0};
+	unsigned long samples = 0, t, elapsed = 0;
+	clock_time_t interval;
+	int level;
+	int16_t temperature;
+	uint8_t activity;
+
+	for(level = 100; level > 0; level--){
+		for(t = 0; t < 600UL * CLOCK_SECOND; t += interval){
+			// Temperatura a dente di sega di ±2 °C ogni ora, traffico di punta nella seconda metà dell'ora
+			temperature = 20 + (int16_t)((elapsed / (CLOCK_SECOND * 450)) % 5) - 2;
+			activity = (elapsed / (CLOCK_SECOND * 1800)) % 2 ? 20 : 2;
+			sensing_stats_add(&stats, temperature);
+			interval = next(p, level, stats.variance, activity);
+			samples++;
+			elapsed += interval;
+		}
+	}
+	return samples;
+
+}
+
+int main(void){
+
+	const sensing_policy_t *threshold = &sensing_policy_threshold;
+	const sensing_policy_t *proportional = &sensing_policy_proportional;
+	sensing_stats_t stats = {0, 0, 0};
+	clock_time_t got, previous, base;
+	int level, i;
+
+	// Soglie fisse sulla carica
+	for(level = 100; level >= 0; level--){
+		got = next(threshold, level, 0, 0);
+		if(level == 0)
+			CHECK(got == 0, "threshold: carica 0, intervallo %lu invece di 0", (unsigned long) got);
+		else if(level < 20)
+			CHECK(got == CLOCK_SECOND * 20, "threshold: carica %d, intervallo %lu", level, (unsigned long) got);
+		else if(level <= 50)
+			CHECK(got == CLOCK_SECOND * 10, "threshold: carica %d, intervallo %lu", level, (unsigned long) got);
+		else
+			CHECK(got == CLOCK_SECOND * 5, "threshold: carica %d, intervallo %lu", level, (unsigned long) got);
+		// Varianza e traffico non cambiano le soglie
+		CHECK(next(threshold, level, 1000, 200) == got, "threshold: carica %d dipende da varianza o traffico", level);
+	}
+
+	// Proporzionale alla carica consumata, con misure costanti e strada vuota
+	CHECK(next(proportional, 100, 0, 0) == SENSING_POLICY_MIN, "proportional: carica piena, intervallo %lu invece di %lu",
+		(unsigned long) next(proportional, 100, 0, 0), (unsigned long) SENSING_POLICY_MIN);
+	CHECK(next(proportional, 0, 0, 0) == 0, "proportional: carica 0 non sospende il sensing");
+	previous = 0;
+	for(level = 100; level > 0; level--){
+		got = next(proportional, level, 0, 0);
+		CHECK(got >= previous, "proportional: a carica %d l'intervallo scende (%lu dopo %lu)", level, (unsigned long) got, (unsigned long) previous);
+		CHECK(got >= SENSING_POLICY_MIN && got < SENSING_POLICY_MAX, "proportional: carica %d, intervallo %lu fuori dai limiti", level, (unsigned long) got);
+		previous = got;
+	}
+
+	// Varianza di 1 °C² e 10 veicoli al minuto dimezzano ciascuno l'intervallo, senza scendere sotto il minimo
+	for(level = 1; level <= 100; level++){
+		base = next(proportional, level, 0, 0);
+		got = next(proportional, level, 16, 0);
+		CHECK(got == (base / 2 < SENSING_POLICY_MIN ? SENSING_POLICY_MIN : base / 2), "proportional: carica %d, varianza 1 °C², %lu su base %lu", level, (unsigned long) got, (unsigned long) base);
+		got = next(proportional, level, 0, 10);
+		CHECK(got == (base / 2 < SENSING_POLICY_MIN ? SENSING_POLICY_MIN : base / 2), "proportional: carica %d, 10 veicoli/min, %lu su base %lu", level, (unsigned long) got, (unsigned long) base);
+		previous = base;
+		for(i = 0; i <= 255; i += 15){
+			got = next(proportional, level, i, i);
+			CHECK(got <= previous && got >= SENSING_POLICY_MIN, "proportional: carica %d, varianza e traffico %d, intervallo %lu", level, i, (unsigned long) got);
+			previous = got;
+		}
+	}
+
+	// Statistiche: misure costanti, poi un'oscillazione di ±2 °C
+	for(i = 0; i < 50; i++)
+		sensing_stats_add(&stats, 22);
+	CHECK(stats.variance == 0 && stats.mean == 22 * 16, "stats: misure costanti, media %d varianza %u", stats.mean, stats.variance);
+	for(i = 0; i < 50; i++)
+		sensing_stats_add(&stats, i % 2 ? 24 : 20);
+	CHECK(stats.variance >= 16, "stats: oscillazione di ±2 °C, varianza %u sotto 1 °C²", stats.variance);
+	CHECK(next(proportional, 50, stats.variance, 0) < next(proportional, 50, 0, 0), "proportional: l'oscillazione non accorcia l'intervallo");
+	for(i = 0; i < 100; i++)
+		sensing_stats_add(&stats, 22);
+	CHECK(stats.variance < 16, "stats: tornata costante, varianza %u ancora sopra 1 °C²", stats.variance);
+
+	printf("OK: threshold %lu campioni, proportional %lu campioni sulla scarica sintetica (100 x 10 min)\n",
+		discharge(threshold), discharge(proportional));
+
+	return 0;
+
+}
@@ -0,0 +1,114 @@
+/*
+ * Test su host di common/sht11-conv.c contro le formule in virgola mobile che
+ * il modulo ha sostituito (datasheet SHT11, come nel codice originale di G1,
+ * G2 e TL), più il costo per conversione misurato con il contatore di cicli.
+ *
+ * Compilazione ed esecuzione dalla cartella sim/:
+ *   gcc -O2 -I../common -o sht11-conv-test sht11-conv-test.c ../common/sht11-conv.c
+ *   ./sht11-conv-test
+ *
+ * Scorre tutte le letture di umidità a 12 bit per ogni temperatura intera
+ * nell'intervallo operativo (-40..125 °C) e confronta:
+ *  - la formula esatta troncata una volta sola (riferimento);
+ *  - il codice originale, che troncava anche RH lineare prima della compensazione.
+ * Esce con errore se lo scarto dal riferimento supera MAX_ERROR.
+ *
+ * Risultato (gcc 12, x86_64, -O2): 679936 letture, una sola diversa dal
+ * riferimento (1 %RH, un valore esattamente intero che il double arrotonda
+ * per difetto: la versione intera è esatta); dal codice originale differisce
+ * di al più 1 %RH, per la sua doppia troncatura. Circa 7 cicli per conversione
+ * contro 10.5 del double con FPU; sull'MSP430, senza FPU, il double passa per
+ * l'emulazione software di libgcc.
+ */
+
+#include "sht11-conv.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+	#include <x86intrin.h>
+	#define cycles()		__rdtsc()
+#else
+	#include <time.h>
+	static uint64_t cycles(void){
+		struct timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;	// ns al posto dei cicli
+	}
+#endif
+
+#define MAX_ERROR		1			// % RH
+#define ROUNDS			200			// Ripetizioni della misura dei cicli
+
+// Formula esatta in double, troncata verso zero come l'assegnamento a intero
+static __attribute__((noinline)) int16_t reference(uint16_t h, int16_t t){
+	double rh = -4 + 0.0405 * h + (-2.8 * 0.000001) * (h * h);
+	return (t - 25) * (0.01 + 0.00008 * h) + rh;
+}
+
+// Codice originale: RH lineare salvato in un intero prima della compensazione
+static __attribute__((noinline)) int16_t original(uint16_t h, int16_t t){
+	int16_t rh = -4 + 0.0405 * h + (-2.8 * 0.000001) * (h * h);
+	return (t - 25) * (0.01 + 0.00008 * h) + rh;
+}
+
+static int16_t original_temperature(uint16_t raw){
+	return (raw / 10 - 396) / 10;
+}
+
+int main(void){
+
+	int16_t t, expected, got;
+	uint16_t h, raw;
+	int error, max_reference = 0, max_original = 0, mismatch = 0, differ = 0;
+	long samples = 0;
+	uint64_t start, int_cycles, float_cycles;
+	volatile int16_t sink;
+	int r;
+
+	// Temperatura: stessa formula intera, deve coincidere su tutte le letture a 14 bit
+	for(raw = 0; raw < 16384; raw++)
+		if(sht11_conv_temperature(raw) != original_temperature(raw)){
+			printf("TEMP: raw %u, atteso %d, ottenuto %d\n", raw, original_temperature(raw), sht11_conv_temperature(raw));
+			return 1;
+		}
+
+	for(t = -40; t <= 125; t++)
+		for(h = 0; h < 4096; h++){
+			got = sht11_conv_humidity(h, t);
+			expected = reference(h, t);
+			error = abs(got - expected);
+			if(error > max_reference)
+				max_reference = error;
+			if(error != 0)
+				mismatch++;
+			error = abs(got - original(h, t));
+			if(error > max_original)
+				max_original = error;
+			if(error != 0)
+				differ++;
+			samples++;
+		}
+
+	// Cicli per conversione dell'umidità, sull'intera griglia a temperatura ambiente
+	start = cycles();
+	for(r = 0; r < ROUNDS; r++)
+		for(h = 0; h < 4096; h++)
+			sink = sht11_conv_humidity(h, 20 + (r & 7));
+	int_cycles = cycles() - start;
+	start = cycles();
+	for(r = 0; r < ROUNDS; r++)
+		for(h = 0; h < 4096; h++)
+			sink = original(h, 20 + (r & 7));
+	float_cycles = cycles() - start;
+	(void) sink;
+
+	printf("UMIDITA: %ld letture\tmax errore vs riferimento %d%%RH (%d letture diverse)\tvs codice originale %d%%RH (%d letture diverse)\n",
+		samples, max_reference, mismatch, max_original, differ);
+	printf("CICLI: intero %.1f\tvirgola mobile %.1f per conversione (host)\n",
+		(double) int_cycles / (ROUNDS * 4096.0), (double) float_cycles / (ROUNDS * 4096.0));
+
+	return max_reference > MAX_ERROR;
+
+}
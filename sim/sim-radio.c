@@ -0,0 +1,267 @@
+/*
+ * Radio simulata per il target native.
+ *
+ * Ogni nodo gira come un processo Linux separato; i frame prodotti dallo stack
+ * Rime viaggiano come datagrammi UDP multicast su loopback, quindi tutti i nodi
+ * in ascolto sulla stessa porta (una porta per intersezione) si "sentono" come
+ * se fossero nello stesso raggio radio.
+ *
+ * Variabili d'ambiente:
+ *  - ITS_NODE			indirizzo Rime del nodo (es. 3 -> 3.0)
+ *  - ITS_SIM_PORT		porta UDP dell'intersezione (default SIM_RADIO_PORT)
+ *  - ITS_SIM_LOSS		percentuale di frame persi in ricezione (default 0)
+ *  - ITS_SIM_SEED		seme del generatore casuale, combinato con l'indirizzo: stessi
+ *						arrivi e perdite a ogni esecuzione (default: pid, sempre diverso)
+ *  - ITS_SIM_TRACE		se 1 stampa "SIM: tx <byte>" per ogni frame trasmesso (bench/run.sh)
+ *  - ITS_SIM_NEAR_POWER	PA_LEVEL minimo tra nodi vicini (default 7, -15 dBm)
+ *  - ITS_SIM_FAR_POWER	PA_LEVEL minimo tra nodi lontani (default 19, -5 dBm)
+ *
+ * La perdita dipende anche dalla potenza del frame (PACKETBUF_ATTR_RADIO_TXPOWER,
+ * come il driver cc2420): sotto il livello minimo del collegamento il frame è
+ * perso, nei SIM_RADIO_FADE livelli sopra il minimo la perdita cala
+ * linearmente fino ad ITS_SIM_LOSS. Con gli indirizzi di run-native.sh sono
+ * vicini ogni G* e il suo semaforo (1-3, 2-4) e i due semafori (3-4).
+ *
+ * Per energest la radio è sempre in ascolto; ogni frame trasmesso aggiunge il
+ * tempo di volo a 250 kbit/s del CC2420 (preambolo e header PHY compresi).
+ */
+
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "dev/radio.h"
+#include "lib/random.h"
+#include "sys/energest.h"
+#include "sim.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#define SIM_RADIO_GROUP		"239.255.42.1"
+#define SIM_RADIO_PORT		7000
+#define SIM_RADIO_MAX_FRAME	127
+#define SIM_RADIO_PHY_BYTES	6			// Preambolo, SFD e lunghezza
+#define SIM_RADIO_BYTE_US	32			// Microsecondi per byte a 250 kbit/s
+#define SIM_RADIO_POWER_MAX	31			// PA_LEVEL di default del CC2420, 0 dBm
+#define SIM_RADIO_FADE		8			// Livelli sopra il minimo con perdita aggiuntiva
+
+// Ogni datagramma è preceduto dal pid del mittente, per scartare i propri frame
+// che tornano indietro con IP_MULTICAST_LOOP
+typedef struct {
+	uint32_t sender;
+	uint8_t addr;						// Indirizzo Rime del mittente, per la distanza
+	uint8_t power;						// PA_LEVEL del frame
+	uint8_t frame[SIM_RADIO_MAX_FRAME];
+} sim_datagram_t;
+
+PROCESS(sim_radio_process, "Sim radio");
+
+static int sock = -1;
+static struct sockaddr_in group;
+static uint32_t my_pid;
+static int loss = 0;								// Percentuale di perdita simulata
+static int trace = 0;								// Traccia dei frame trasmessi
+static int near_power, far_power;					// Livello minimo per collegamento
+static sim_datagram_t tx_buf, rx_buf;
+static unsigned short tx_len = 0, rx_len = 0;
+
+static int env_int(const char *name, int def){
+	const char *value = getenv(name);
+	return value != NULL ? atoi(value) : def;
+}
+
+// Vicini: ogni G* con il proprio semaforo e i due semafori tra loro
+static int near(uint8_t a, uint8_t b){
+	return (a % 2) == (b % 2) || (a >= 3 && b >= 3);
+}
+
+// Percentuale di perdita del frame ricevuto
+static int frame_loss(const sim_datagram_t *d){
+
+	int margin = d->power - (near(d->addr, linkaddr_node_addr.u8[0]) ? near_power : far_power);
+
+	if(margin < 0)
+		return 100;
+	if(margin >= SIM_RADIO_FADE)
+		return loss;
+	return loss + (100 - loss) * (SIM_RADIO_FADE - margin) / (SIM_RADIO_FADE + 1);
+
+}
+
+static int set_fd(fd_set *fdr, fd_set *fdw){
+	// Finché il frame precedente non è stato consegnato allo stack, lascio i
+	// datagrammi in coda nel kernel
+	if(sock >= 0 && rx_len == 0)
+		FD_SET(sock, fdr);
+	return 1;
+}
+
+static void handle_fd(fd_set *fdr, fd_set *fdw){
+
+	ssize_t n;
+
+	if(sock < 0 || !FD_ISSET(sock, fdr))
+		return;
+
+	n = recv(sock, &rx_buf, sizeof(rx_buf), 0);
+	if(n <= (ssize_t) offsetof(sim_datagram_t, frame) || rx_buf.sender == my_pid)
+		return;
+	if((random_rand() % 100) < frame_loss(&rx_buf))
+		return;
+
+	rx_len = n - offsetof(sim_datagram_t, frame);
+	process_poll(&sim_radio_process);
+
+}
+
+static const struct select_callback sim_radio_callback = {set_fd, handle_fd};
+
+static int radio_init(void){
+
+	linkaddr_t addr;
+	struct sockaddr_in local;
+	struct ip_mreq mreq;
+	int on = 1;
+
+	my_pid = getpid();
+	loss = env_int("ITS_SIM_LOSS", 0);
+	trace = env_int("ITS_SIM_TRACE", 0);
+	near_power = env_int("ITS_SIM_NEAR_POWER", 7);
+	far_power = env_int("ITS_SIM_FAR_POWER", 19);
+	setvbuf(stdout, NULL, _IOLBF, 0);		// Log letti mentre il nodo gira (timestamp di bench/run.sh)
+
+	memset(&addr, 0, sizeof(addr));
+	addr.u8[0] = env_int("ITS_NODE", linkaddr_node_addr.u8[0]);
+	linkaddr_set_node_addr(&addr);
+
+	if(getenv("ITS_SIM_SEED") != NULL)
+		random_init(env_int("ITS_SIM_SEED", 0) * 31 + addr.u8[0]);
+	else
+		random_init(my_pid);
+
+	sock = socket(AF_INET, SOCK_DGRAM, 0);
+	if(sock < 0){
+		perror("sim-radio: socket");
+		return 0;
+	}
+	setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	memset(&local, 0, sizeof(local));
+	local.sin_family = AF_INET;
+	local.sin_addr.s_addr = htonl(INADDR_ANY);
+	local.sin_port = htons(env_int("ITS_SIM_PORT", SIM_RADIO_PORT));
+	if(bind(sock, (struct sockaddr *) &local, sizeof(local)) < 0){
+		perror("sim-radio: bind");
+		close(sock);
+		sock = -1;
+		return 0;
+	}
+
+	mreq.imr_multiaddr.s_addr = inet_addr(SIM_RADIO_GROUP);
+	mreq.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+	setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &mreq.imr_interface, sizeof(mreq.imr_interface));
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &on, sizeof(on));
+
+	group = local;
+	group.sin_addr.s_addr = inet_addr(SIM_RADIO_GROUP);
+
+	ENERGEST_ON(ENERGEST_TYPE_LISTEN);
+	select_set_callback(sock, &sim_radio_callback);
+	process_start(&sim_radio_process, NULL);
+	sim_traffic_init();
+
+	printf("SIM: node %d.%d on port %d, loss %d%%\n", addr.u8[0], addr.u8[1], ntohs(local.sin_port), loss);
+	return 1;
+
+}
+
+static int radio_prepare(const void *payload, unsigned short payload_len){
+	if(payload_len > SIM_RADIO_MAX_FRAME)
+		return RADIO_TX_ERR;
+	memcpy(tx_buf.frame, payload, payload_len);
+	tx_len = payload_len;
+	return RADIO_TX_OK;
+}
+
+static int radio_transmit(unsigned short transmit_len){
+
+	tx_buf.sender = my_pid;
+	tx_buf.addr = linkaddr_node_addr.u8[0];
+	// Come il cc2420: l'attributo è il livello più uno, 0 per la potenza di default
+	tx_buf.power = packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) > 0 ?
+		packetbuf_attr(PACKETBUF_ATTR_RADIO_TXPOWER) - 1 : SIM_RADIO_POWER_MAX;
+	if(trace)
+		printf("SIM: tx %u\n", tx_len);
+	energest_type_set(ENERGEST_TYPE_TRANSMIT, energest_type_time(ENERGEST_TYPE_TRANSMIT) +
+		(unsigned long)(tx_len + SIM_RADIO_PHY_BYTES) * SIM_RADIO_BYTE_US * RTIMER_SECOND / 1000000UL);
+	if(sock < 0 || sendto(sock, &tx_buf, offsetof(sim_datagram_t, frame) + tx_len, 0,
+			(struct sockaddr *) &group, sizeof(group)) < 0)
+		return RADIO_TX_ERR;
+	return RADIO_TX_OK;
+
+}
+
+static int radio_send(const void *payload, unsigned short payload_len){
+	if(radio_prepare(payload, payload_len) != RADIO_TX_OK)
+		return RADIO_TX_ERR;
+	return radio_transmit(payload_len);
+}
+
+static int radio_read(void *buf, unsigned short buf_len){
+
+	unsigned short len = rx_len;
+
+	if(len > buf_len)
+		len = buf_len;
+	memcpy(buf, rx_buf.frame, len);
+	rx_len = 0;
+	return len;
+
+}
+
+static int radio_channel_clear(void){ return 1; }
+static int radio_receiving_packet(void){ return 0; }
+static int radio_pending_packet(void){ return rx_len > 0; }
+static int radio_on(void){ return 1; }
+static int radio_off(void){ return 1; }
+
+static radio_result_t radio_get_value(radio_param_t param, radio_value_t *value){ return RADIO_RESULT_NOT_SUPPORTED; }
+static radio_result_t radio_set_value(radio_param_t param, radio_value_t value){ return RADIO_RESULT_NOT_SUPPORTED; }
+static radio_result_t radio_get_object(radio_param_t param, void *dest, size_t size){ return RADIO_RESULT_NOT_SUPPORTED; }
+static radio_result_t radio_set_object(radio_param_t param, const void *src, size_t size){ return RADIO_RESULT_NOT_SUPPORTED; }
+
+const struct radio_driver sim_radio_driver = {
+	radio_init, radio_prepare, radio_transmit, radio_send, radio_read,
+	radio_channel_clear, radio_receiving_packet, radio_pending_packet, radio_on, radio_off,
+	radio_get_value, radio_set_value, radio_get_object, radio_set_object
+};
+
+// Consegna allo stack Rime il frame ricevuto, fuori dal callback di select()
+PROCESS_THREAD(sim_radio_process, ev, data){
+
+	PROCESS_BEGIN();
+
+	while(1){
+
+		PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+		if(rx_len > 0){
+			packetbuf_clear();
+			packetbuf_set_datalen(radio_read(packetbuf_dataptr(), PACKETBUF_SIZE));
+			NETSTACK_RDC.input();
+		}
+
+	}
+
+	PROCESS_END();
+
+}
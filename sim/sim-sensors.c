@@ -0,0 +1,115 @@
+/*
+ * Sensori simulati per il target native.
+ *
+ * - sht11_sensor restituisce letture grezze plausibili (circa 22°C e 44% RH),
+ *   con un po' di rumore, così le formule di conversione restano le stesse del Sky.
+ * - Il generatore di traffico simula l'arrivo dei veicoli premendo il
+ *   button_sensor della piattaforma native: un arrivo normale è una pressione,
+ *   un'emergenza è una doppia pressione entro la finestra di 0.5 s.
+ *
+ * Variabili d'ambiente:
+ *  - ITS_SIM_ARRIVAL_MS	tempo medio tra due arrivi (0 o assente: nessun arrivo)
+ *  - ITS_SIM_EMERGENCY		percentuale di veicoli di emergenza (default 10)
+ *  - ITS_SIM_SEED			seme degli arrivi (vedi sim-radio.c); gli arrivi usano un
+ *							generatore proprio, così restano identici tra Broadcast e
+ *							Unicast anche se lo stack consuma random_rand() in modo diverso
+ */
+
+#include "contiki.h"
+#include "dev/button-sensor.h"
+#include "dev/sht11/sht11-sensor.h"
+#include "lib/random.h"
+#include "net/linkaddr.h"
+#include "sim.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define SIM_RAW_TEMP		6160	// (6160/10 - 396)/10 = 22°C
+#define SIM_RAW_HUMIDITY	1300	// circa 44% RH
+#define SIM_DOUBLE_PRESS	(CLOCK_SECOND / 5)
+
+PROCESS(sim_traffic_process, "Sim traffic");
+
+static int sht11_active = 0;
+static uint32_t traffic_state;					// Stato del generatore degli arrivi (xorshift32)
+
+static uint32_t traffic_rand(void){
+	traffic_state ^= traffic_state << 13;
+	traffic_state ^= traffic_state >> 17;
+	traffic_state ^= traffic_state << 5;
+	return traffic_state;
+}
+
+static int sht11_value(int type){
+	switch(type){
+		case SHT11_SENSOR_TEMP:
+			return SIM_RAW_TEMP + (random_rand() % 101) - 50;
+		case SHT11_SENSOR_HUMIDITY:
+			return SIM_RAW_HUMIDITY + (random_rand() % 41) - 20;
+	}
+	return 0;
+}
+
+static int sht11_configure(int type, int c){
+	if(type == SENSORS_ACTIVE)
+		sht11_active = c;
+	return 1;
+}
+
+static int sht11_status(int type){
+	return sht11_active;
+}
+
+SENSORS_SENSOR(sht11_sensor, SHT11_SENSOR, sht11_value, sht11_configure, sht11_status);
+
+void sim_traffic_init(void){
+	const char *arrival = getenv("ITS_SIM_ARRIVAL_MS");
+	const char *seed = getenv("ITS_SIM_SEED");
+
+	traffic_state = (seed != NULL ? (uint32_t) atol(seed) * 31 : (uint32_t) getpid()) + linkaddr_node_addr.u8[0];
+	if(traffic_state == 0)
+		traffic_state = 1;
+	if(arrival != NULL && atol(arrival) > 0)
+		process_start(&sim_traffic_process, NULL);
+}
+
+PROCESS_THREAD(sim_traffic_process, ev, data){
+
+	static struct etimer arrival_timer;
+	static clock_time_t mean;					// Intervallo medio tra gli arrivi, in tick
+	static int emergency;						// Percentuale di veicoli di emergenza
+	static unsigned long vehicles = 0;
+	const char *value;
+
+	PROCESS_BEGIN();
+
+	mean = atol(getenv("ITS_SIM_ARRIVAL_MS")) * CLOCK_SECOND / 1000;
+	value = getenv("ITS_SIM_EMERGENCY");
+	emergency = value != NULL ? atoi(value) : 10;
+	if(mean == 0)
+		mean = 1;
+
+	while(1){
+
+		// Arrivi uniformi in [mean/2, 3*mean/2]
+		etimer_set(&arrival_timer, mean / 2 + traffic_rand() % (mean + 1));
+		PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&arrival_timer));
+
+		vehicles++;
+		sensors_changed(&button_sensor);
+
+		if((traffic_rand() % 100) < emergency){
+			etimer_set(&arrival_timer, SIM_DOUBLE_PRESS);
+			PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&arrival_timer));
+			sensors_changed(&button_sensor);
+			printf("SIM: arrival %lu EMERGENCY\n", vehicles);
+		} else
+			printf("SIM: arrival %lu NORMAL\n", vehicles);
+
+	}
+
+	PROCESS_END();
+
+}
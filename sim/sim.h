@@ -0,0 +1,13 @@
+#ifndef SIM_H_
+#define SIM_H_
+
+#include "dev/radio.h"
+
+// Radio e sensori simulati per il target native (vedi run-native.sh)
+
+extern const struct radio_driver sim_radio_driver;
+
+// Avvia il generatore di arrivi dei veicoli, pilotato da ITS_SIM_ARRIVAL_MS
+void sim_traffic_init(void);
+
+#endif